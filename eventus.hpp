@@ -11,160 +11,2969 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <new>
 #include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
 #include <typeinfo>
 #include <type_traits>
 #include <unordered_map>
+#include <utility>
 #include <vector>
+#if __cplusplus >= 201703L
+#include <string_view>
+#if defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define EVENTUS_STD_MEMORY_RESOURCE
+#endif
+#endif
+#endif
+#ifdef EVENTUS_TRACE
+#include <cstdio>
+#include <unordered_set>
+#endif
+
+#ifndef EVENTUS_DELEGATE_SIZE
+/*! @brief Size in bytes of the buffer each event handler is stored in.
+ *
+ *  Handlers (lambdas, function objects, etc.) which fit are stored inline with the other handlers of the same event.
+ *  Larger handlers are allocated on the heap. Define before including eventus.hpp to change it.
+ */
+#define EVENTUS_DELEGATE_SIZE (4 * sizeof(void*))
+#endif
+
+/*! @def EVENTUS_METRICS
+ *  @brief Define before including eventus.hpp to count the fires of each event and time each handler.
+ *
+ *  The counters are read with @ref eventus::event_queue::metrics. When it isn't defined, none of this is compiled,
+ *  so it costs nothing. Every translation unit of a program must agree on it.
+ */
+
+/*! @def EVENTUS_TRACE
+ *  @brief Define before including eventus.hpp to record a span for each fire and each handler call, which
+ *  @ref eventus::write_trace writes out as a Chrome trace.
+ *
+ *  Like @ref EVENTUS_METRICS, none of it is compiled when it isn't defined, and every translation unit of a program
+ *  must agree on it.
+ */
+
+#ifndef EVENTUS_TRACE_BUFFER_SIZE
+/*! @brief The number of spans each thread can record for @ref EVENTUS_TRACE. Spans recorded once a thread's buffer
+ *  is full are dropped, and counted. Define before including eventus.hpp to change it.
+ */
+#define EVENTUS_TRACE_BUFFER_SIZE 65536
+#endif
+
+namespace eventus {
+    /// Receives and dispatches events
+    template<typename event_type> class event_queue;
+
+    /// A handle to an event handler object
+    template<typename event_type, typename T> class handler_info;
+
+    /// A pre-resolved handle to an event which can be fired without looking the event up
+    template<typename event_type, typename T> class event_channel;
+
+    /// Receives and dispatches events, and can be used from multiple threads at once
+    template<typename event_type> class concurrent_event_queue;
+
+    /// Receives and dispatches events which are declared as types, all known at compile time
+    template<typename... Events> class static_event_queue;
+
+    /// A pool of worker threads which run handlers for `event_queue::fire_async`
+    class worker_pool;
+
+    /// A compact id for a string interned in a @ref string_pool, usable as an event type
+    class symbol;
+
+    /// Interns strings as @ref symbol ids
+    class string_pool;
+
+    /// What @ref event_ring::post does when the ring is full
+    enum class overflow_policy {
+        block,       ///< Wait until the consumer makes room.
+        drop_newest, ///< Discard the event being posted.
+        drop_oldest  ///< Discard the oldest event in the ring to make room.
+    };
+
+    /// A bounded lock-free buffer which any thread can post events to, to be fired on the thread owning an event_queue
+    template<typename event_type, size_t Size> class event_ring;
+
+    /// Holds the latest parameter of each event posted to it, to be fired through an event_queue once per dispatch
+    template<typename event_type> class coalescing_queue;
+
+    /*! @brief Declares that the keys of an enum or integral event type are dense, from 0 up to but not including
+     *  `value`.
+     *
+     *  An `event_queue` with such keys stores each event's handlers in a flat array indexed by the key, rather than in
+     *  a hash table. Specialize it for the event type:
+     *  @code
+     *  enum class window_event { moved, resized, closed, count };
+     *  namespace eventus {
+     *      template<> struct event_key_bound<window_event> :
+     *          std::integral_constant<size_t, static_cast<size_t>(window_event::count)> {};
+     *  }
+     *  @endcode
+     *  Keys at or beyond the bound can't have handlers; @ref event_queue::add_handler throws `std::out_of_range` for
+     *  them.
+     */
+    template<typename event_type> struct event_key_bound : std::integral_constant<size_t, 0> {};
+
+#ifdef EVENTUS_TRACE
+    /*! @brief Names events in traces, when @ref EVENTUS_TRACE is defined.
+     *
+     *  Strings name themselves, enum and integral keys are named by their value, and symbols by their id. Specialize
+     *  it to name the events of other types:
+     *  @code
+     *  namespace eventus {
+     *      template<> struct event_name<my_key> {
+     *          static std::string get(const my_key& key) { return key.label; }
+     *      };
+     *  }
+     *  @endcode
+     */
+    template<typename event_type, typename = void> struct event_name {
+        static std::string get(const event_type&) { return "event"; }
+    };
+    template<typename event_type>
+    struct event_name<event_type, typename std::enable_if<std::is_integral<event_type>::value>::type> {
+        static std::string get(const event_type& event) { return std::to_string(event); }
+    };
+    template<typename event_type>
+    struct event_name<event_type, typename std::enable_if<std::is_enum<event_type>::value>::type> {
+        static std::string get(const event_type& event) {
+            return std::to_string(static_cast<typename std::underlying_type<event_type>::type>(event));
+        }
+    };
+    template<> struct event_name<std::string> {
+        static std::string get(const std::string& event) { return event; }
+    };
+    template<> struct event_name<const char*> {
+        static std::string get(const char* event) { return event; }
+    };
+#endif
+
+#ifdef EVENTUS_STD_MEMORY_RESOURCE
+    /// Where event queues allocate their storage from: `std::pmr::memory_resource`.
+    typedef std::pmr::memory_resource memory_resource;
+
+    /// The resource event queues allocate from unless they are given one, `std::pmr::get_default_resource()`.
+    inline memory_resource* default_resource() noexcept { return std::pmr::get_default_resource(); }
+#else
+    /*! @brief Where event queues allocate their storage from.
+     *
+     *  It has the interface of `std::pmr::memory_resource`, which it is an alias for when `<memory_resource>` is
+     *  available (c++17 and later), so the same resources work in either case.
+     */
+    class memory_resource {
+    public:
+        virtual ~memory_resource() {}
+
+        void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+            return do_allocate(bytes, alignment);
+        }
+        void deallocate(void* p, size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+            do_deallocate(p, bytes, alignment);
+        }
+        bool is_equal(const memory_resource& other) const noexcept { return do_is_equal(other); }
+
+    private:
+        virtual void* do_allocate(size_t bytes, size_t alignment) = 0;
+        virtual void do_deallocate(void* p, size_t bytes, size_t alignment) = 0;
+        virtual bool do_is_equal(const memory_resource& other) const noexcept = 0;
+    };
+
+    /// The resource event queues allocate from unless they are given one, which uses `operator new`.
+    inline memory_resource* default_resource() noexcept {
+        struct new_delete_resource : memory_resource {
+            void* do_allocate(size_t bytes, size_t) override { return ::operator new(bytes); }
+            void do_deallocate(void* p, size_t, size_t) override { ::operator delete(p); }
+            bool do_is_equal(const memory_resource& other) const noexcept override { return this == &other; }
+        };
+        static new_delete_resource resource;
+        return &resource;
+    }
+#endif
+
+#ifdef EVENTUS_METRICS
+    /*! @brief Counts durations in nanoseconds, in buckets which widen with the duration, like HdrHistogram.
+     *
+     *  Durations below 4ns have a bucket each. Above that, each power of two is split into 4 buckets, so every
+     *  duration in a bucket is within 25% of the bucket's lower bound. Durations over half an hour share the last
+     *  bucket.
+     */
+    class latency_histogram {
+    private:
+        // Each power of two is split into 1 << SUB_BITS buckets
+        static const unsigned SUB_BITS = 2;
+        static const size_t BUCKETS = 160;
+
+        uint64_t _counts[BUCKETS];
+        uint64_t _count;
+        uint64_t _total;
+        uint64_t _max;
+
+    public:
+        latency_histogram() { reset(); }
+
+        /// Adds a duration.
+        void record(uint64_t nanoseconds) {
+            ++_counts[bucket(nanoseconds)];
+            ++_count;
+            _total += nanoseconds;
+            if (nanoseconds > _max)
+                _max = nanoseconds;
+        }
+
+        /// Removes every duration.
+        void reset() {
+            std::fill(_counts, _counts + BUCKETS, uint64_t(0));
+            _count = 0;
+            _total = 0;
+            _max = 0;
+        }
+
+        /// Gets the number of durations recorded.
+        uint64_t count() const { return _count; }
+
+        /// Gets the sum of the durations recorded.
+        uint64_t total() const { return _total; }
+
+        /// Gets the longest duration recorded, or 0.
+        uint64_t max() const { return _max; }
+
+        /*! @brief Gets an upper bound on the durations which percent of the recorded durations are at or below, e.g.
+         *  99 for the 99th percentile. It is the upper bound of the bucket the percentile falls in, or the longest
+         *  duration if that is lower. Returns 0 if nothing was recorded.
+         */
+        uint64_t percentile(double percent) const {
+            if (_count == 0)
+                return 0;
+            auto rank = static_cast<uint64_t>(std::ceil(percent / 100 * static_cast<double>(_count)));
+            uint64_t seen = 0;
+            for (size_t i = 0; i + 1 < BUCKETS; ++i) {
+                seen += _counts[i];
+                if (seen >= rank && seen != 0)
+                    return std::min(lower_bound(i + 1) - 1, _max);
+            }
+            return _max;
+        }
+
+        /// Gets the number of buckets.
+        static constexpr size_t size() { return BUCKETS; }
+
+        /// Gets the number of durations recorded in a bucket.
+        uint64_t count(size_t bucket) const { return _counts[bucket]; }
+
+        /// Gets the bucket a duration is counted in.
+        static size_t bucket(uint64_t nanoseconds) {
+            const uint64_t sub_buckets = uint64_t(1) << SUB_BITS;
+            if (nanoseconds < sub_buckets)
+                return static_cast<size_t>(nanoseconds);
+
+            unsigned exponent = SUB_BITS;
+            while (exponent < 63 && (nanoseconds >> (exponent + 1)) != 0)
+                ++exponent;
+            auto sub_bucket = (nanoseconds >> (exponent - SUB_BITS)) & (sub_buckets - 1);
+            auto index = (exponent - SUB_BITS + 1) * sub_buckets + sub_bucket;
+            return index < BUCKETS ? static_cast<size_t>(index) : BUCKETS - 1;
+        }
+
+        /// Gets the shortest duration counted in a bucket.
+        static uint64_t lower_bound(size_t bucket) {
+            const uint64_t sub_buckets = uint64_t(1) << SUB_BITS;
+            if (bucket < sub_buckets)
+                return bucket;
+
+            auto exponent = bucket / sub_buckets + SUB_BITS - 1;
+            return (sub_buckets + bucket % sub_buckets) << (exponent - SUB_BITS);
+        }
+    };
+
+    /// The counters of one event handler, from @ref event_queue::metrics.
+    struct handler_metrics {
+        /// The priority the handler was added with.
+        int priority;
+        /// How long each call to the handler took. Its count is the number of calls.
+        latency_histogram latency;
+    };
+
+    /// The counters of one event, from @ref event_queue::metrics.
+    template<typename event_type> struct event_metrics {
+        event_type event;
+        /// The number of times the event was fired, with or without handlers.
+        uint64_t fires;
+        /// The number of handler calls, across every fire.
+        uint64_t handlers_invoked;
+        /// The handlers of the event, in the order they are called.
+        std::vector<handler_metrics> handlers;
+    };
+#endif
+}
+
+namespace _eventus_util {
+    using namespace std;
+
+    // Identifies a type without RTTI. Each instantiation of type_tag has its own static member, so its address is
+    // unique to the type. The member has default visibility, so shared libraries built with -fvisibility=hidden still
+    // share one copy of it for types which are visible themselves. A DLL has its own copy, so a parameter passed across
+    // a DLL boundary fails the type check.
+#if defined(__GNUC__) || defined(__clang__)
+#define EVENTUS_TYPE_TAG_VISIBILITY __attribute__((visibility("default")))
+#else
+#define EVENTUS_TYPE_TAG_VISIBILITY
+#endif
+    typedef const void* type_id_t;
+    template<typename T> struct EVENTUS_TYPE_TAG_VISIBILITY type_tag { static const char id; };
+    template<typename T> const char type_tag<T>::id = 0;
+    template<typename T> constexpr type_id_t type_id() { return &type_tag<T>::id; }
+
+#ifdef EVENTUS_TRACE
+    // Cuts the name of T out of the signature of type_name<T>.
+    inline string type_name_from(const string& signature) {
+#if defined(_MSC_VER) && !defined(__clang__)
+        auto begin = signature.find("type_name<") + 10;
+        auto end = signature.rfind(">(void)");
+#else
+        auto begin = signature.find("T = ") + 4;
+        auto end = signature.find_first_of(";]", begin);
+#endif
+        return signature.substr(begin, end - begin);
+    }
+
+    // The name of T for traces, taken from the signature of this function, since there's no RTTI.
+    template<typename T> const char* type_name() {
+#if defined(_MSC_VER) && !defined(__clang__)
+        static const string name = type_name_from(__FUNCSIG__);
+#else
+        static const string name = type_name_from(__PRETTY_FUNCTION__);
+#endif
+        return name.c_str();
+    }
+
+    // A fire of an event, or a call to one of its handlers.
+    struct trace_span_record {
+        const char* event;
+        const char* type;
+        // Nanoseconds since the trace_log was created
+        uint64_t start;
+        uint64_t duration;
+        // The number of fires the span is nested in, not counting its own
+        int depth;
+        bool handler;
+    };
+
+    // The spans recorded on one thread. Only that thread writes to it, and it publishes each span by storing size with
+    // release, so the spans below size can be read from any thread.
+    struct trace_buffer {
+        unique_ptr<trace_span_record[]> spans;
+        atomic<size_t> size;
+        atomic<size_t> dropped;
+        uint32_t thread;
+        // The number of fires the thread is inside of
+        int depth;
+
+        explicit trace_buffer(uint32_t t) :
+            spans(new trace_span_record[EVENTUS_TRACE_BUFFER_SIZE]), size(0), dropped(0), thread{t}, depth{0} {}
+
+        void record(const trace_span_record& span) {
+            auto n = size.load(memory_order_relaxed);
+            if (n == EVENTUS_TRACE_BUFFER_SIZE) {
+                dropped.store(dropped.load(memory_order_relaxed) + 1, memory_order_relaxed);
+                return;
+            }
+            spans[n] = span;
+            size.store(n + 1, memory_order_release);
+        }
+    };
+
+    // The buffers of every thread which has recorded a span, and the names of the events. They are kept until the
+    // program exits, so spans outlive their threads and queues. Only registering a thread and interning a name lock.
+    class trace_log {
+    private:
+        mutex _mutex;
+        deque<trace_buffer> _buffers;
+        unordered_set<string> _names;
+        const chrono::steady_clock::time_point _epoch;
+
+        trace_log() : _epoch(chrono::steady_clock::now()) {}
+
+        static void write_escaped(FILE* file, const char* s) {
+            for (; *s != 0; ++s) {
+                auto c = static_cast<unsigned char>(*s);
+                if (c == '"' || c == '\\')
+                    fprintf(file, "\\%c", c);
+                else if (c < 0x20)
+                    fprintf(file, "\\u%04x", c);
+                else
+                    fputc(c, file);
+            }
+        }
+
+    public:
+        static trace_log& instance() {
+            static trace_log log;
+            return log;
+        }
+
+        uint64_t now() const {
+            return static_cast<uint64_t>(
+                chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - _epoch).count());
+        }
+
+        const char* intern(const string& name) {
+            lock_guard<mutex> lock(_mutex);
+            return _names.insert(name).first->c_str();
+        }
+
+        // The buffer of the calling thread, which is registered the first time it records a span.
+        trace_buffer& buffer() {
+            static thread_local trace_buffer* buffer = nullptr;
+            if (buffer == nullptr) {
+                lock_guard<mutex> lock(_mutex);
+                _buffers.emplace_back(static_cast<uint32_t>(_buffers.size() + 1));
+                buffer = &_buffers.back();
+            }
+            return *buffer;
+        }
+
+        bool write(const string& path) {
+            auto file = fopen(path.c_str(), "w");
+            if (file == nullptr)
+                return false;
+
+            lock_guard<mutex> lock(_mutex);
+            size_t dropped = 0;
+            auto first = true;
+            fprintf(file, "{\"traceEvents\":[");
+            for (auto& buffer : _buffers) {
+                dropped += buffer.dropped.load(memory_order_relaxed);
+                auto size = buffer.size.load(memory_order_acquire);
+                for (size_t i = 0; i < size; ++i) {
+                    const auto& span = buffer.spans[i];
+                    fprintf(file, "%s\n{\"name\":\"", first ? "" : ",");
+                    write_escaped(file, span.event);
+                    fprintf(file, "\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u,"
+                            "\"args\":{\"type\":\"", span.handler ? "handler" : "fire", span.start / 1000.0,
+                            span.duration / 1000.0, static_cast<unsigned>(buffer.thread));
+                    write_escaped(file, span.type);
+                    fprintf(file, "\",\"depth\":%d}}", span.depth);
+                    first = false;
+                }
+            }
+            fprintf(file, "\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped_spans\":%zu}}\n", dropped);
+            return fclose(file) == 0;
+        }
+
+        void clear() {
+            lock_guard<mutex> lock(_mutex);
+            for (auto& buffer : _buffers) {
+                buffer.size.store(0, memory_order_relaxed);
+                buffer.dropped.store(0, memory_order_relaxed);
+            }
+        }
+    };
+
+    // Records a span from its construction to its destruction, including when a handler throws.
+    class trace_span {
+    private:
+        trace_buffer& _buffer;
+        trace_span_record _record;
+
+    public:
+        trace_span(const char* event, const char* type, bool handler) :
+            _buffer(trace_log::instance().buffer()),
+            _record{event, type, trace_log::instance().now(), 0, 0, handler} {
+            _record.depth = handler ? _buffer.depth - 1 : _buffer.depth++;
+        }
+        trace_span(const trace_span&) = delete;
+        trace_span& operator=(const trace_span&) = delete;
+
+        ~trace_span() {
+            if (!_record.handler)
+                --_buffer.depth;
+            _record.duration = trace_log::instance().now() - _record.start;
+            _buffer.record(_record);
+        }
+    };
+#endif
+
+    struct any_t {
+        struct basetype {
+            type_id_t type;
+            basetype(type_id_t t) : type{t} {}
+            virtual ~basetype() {}
+            // Destroys this and gives its memory back to the resource it was allocated from
+            virtual void destroy(eventus::memory_resource& resource) = 0;
+        };
+        template<typename T> struct supertype : public basetype {
+            T value;
+            supertype(T&& val) : basetype(type_id<T>()), value{forward<T>(val)} {}
+            void destroy(eventus::memory_resource& resource) override {
+                this->~supertype();
+                resource.deallocate(this, sizeof(supertype), alignof(supertype));
+            }
+        };
+        struct deleter {
+            eventus::memory_resource* resource;
+            void operator()(basetype* p) const { p->destroy(*resource); }
+        };
+        template<typename T>
+        static any_t create(T&& value, eventus::memory_resource& resource = *eventus::default_resource());
+        template<typename T> static T& cast(any_t& c);
+        unique_ptr<basetype, deleter> ptr;
+        any_t() : ptr(nullptr, deleter{nullptr}) {}
+        any_t(unique_ptr<basetype, deleter>&& p) : ptr{move(p)} {}
+    };
+
+    template<typename T>
+    any_t any_t::create(T&& value, eventus::memory_resource& resource) {
+        auto memory = resource.allocate(sizeof(supertype<T>), alignof(supertype<T>));
+        try {
+            auto p = new (memory) supertype<T>(forward<T>(value));
+            return any_t(unique_ptr<basetype, deleter>(p, deleter{&resource}));
+        }
+        catch (...) {
+            resource.deallocate(memory, sizeof(supertype<T>), alignof(supertype<T>));
+            throw;
+        }
+    }
+
+    // A standard allocator which allocates from a memory_resource, like std::pmr::polymorphic_allocator (which c++11
+    // doesn't have). Containers keep it when they are moved, so a container stays with its resource.
+    template<typename T> struct resource_allocator {
+        typedef T value_type;
+        // Containers hand their storage over on move assignment and swap, along with the resource it came from, so
+        // maps of const keys can be move assigned
+        typedef true_type propagate_on_container_move_assignment;
+        typedef true_type propagate_on_container_swap;
+
+        eventus::memory_resource* resource;
+
+        resource_allocator(eventus::memory_resource& r) noexcept : resource{&r} {}
+        template<typename U>
+        resource_allocator(const resource_allocator<U>& other) noexcept : resource{other.resource} {}
+
+        T* allocate(size_t n) { return static_cast<T*>(resource->allocate(n * sizeof(T), alignof(T))); }
+        void deallocate(T* p, size_t n) noexcept { resource->deallocate(p, n * sizeof(T), alignof(T)); }
+    };
+    template<typename T, typename U>
+    bool operator==(const resource_allocator<T>& a, const resource_allocator<U>& b) noexcept {
+        return a.resource == b.resource || a.resource->is_equal(*b.resource);
+    }
+    template<typename T, typename U>
+    bool operator!=(const resource_allocator<T>& a, const resource_allocator<U>& b) noexcept { return !(a == b); }
+
+    template<typename T> using resource_vector = vector<T, resource_allocator<T>>;
+    template<typename T> using resource_deque = deque<T, resource_allocator<T>>;
+
+    template<typename T>
+    T& any_t::cast(any_t& c) {
+        if (type_id<T>() != c.ptr->type)
+            throw bad_cast();
+        return static_cast<supertype<T>*>(c.ptr.get())->value;
+    }
+
+#if __cplusplus < 201402L
+    // Workaround for enums and class enums in c++11
+    struct enum_hash {
+        template<typename T> size_t operator()(T key) const { return static_cast<size_t>(key); }
+    };
+    template<typename T>
+    using hasher = typename conditional<is_enum<T>::value, enum_hash, hash<T>>::type;
+#else
+    template<typename T> using hasher = hash<T>;
+#endif
+
+    // Hashes strings without constructing a std::string. It mixes in 8 bytes at a time (as FxHash does), with a final
+    // mix so the low bits, which hash tables mask with, depend on every byte.
+    inline size_t hash_bytes(const char* bytes, size_t length) {
+        const uint64_t K = 0x517cc1b727220a95ull;
+        uint64_t h = length;
+        for (; length >= 8; bytes += 8, length -= 8) {
+            uint64_t word;
+            memcpy(&word, bytes, 8);
+            h = ((h << 5 | h >> 59) ^ word) * K;
+        }
+        if (length != 0) {
+            uint64_t word = 0;
+            memcpy(&word, bytes, length);
+            h = ((h << 5 | h >> 59) ^ word) * K;
+        }
+        h ^= h >> 32;
+        h *= K;
+        h ^= h >> 29;
+        return static_cast<size_t>(h);
+    }
+
+    // A map from dense enum or integral keys in [0, N) to values, stored inline in an array. It has the parts of the
+    // unordered_map interface which event_queue uses, with pointers for iterators.
+    template<typename K, typename V, size_t N> class dense_map {
+    public:
+        typedef pair<const K, V> value_type;
+        typedef value_type* iterator;
+
+    private:
+        static_assert(is_enum<K>::value || is_integral<K>::value, "event_key_bound needs enum or integral keys");
+
+        typename aligned_storage<sizeof(value_type), alignof(value_type)>::type _storage[N];
+        bool _used[N];
+
+        value_type* _at(size_t index) { return reinterpret_cast<value_type*>(&_storage[index]); }
+
+        static size_t _index(const K& key) { return static_cast<size_t>(key); }
+
+        void _destroy() {
+            for (size_t i = 0; i < N; ++i) {
+                if (_used[i])
+                    _at(i)->~value_type();
+            }
+        }
+
+        void _move_from(dense_map& other) {
+            for (size_t i = 0; i < N; ++i) {
+                _used[i] = other._used[i];
+                if (_used[i])
+                    new (&_storage[i]) value_type(move(*other._at(i)));
+            }
+        }
+
+    public:
+        dense_map() { fill(_used, _used + N, false); }
+        // The array is stored inline, so it needs nothing from the resource
+        explicit dense_map(eventus::memory_resource&) : dense_map() {}
+
+        dense_map(dense_map&& other) { _move_from(other); }
+
+        // The keys are const, so the entries are destroyed and moved in again rather than assigned
+        dense_map& operator=(dense_map&& other) {
+            if (this != &other) {
+                _destroy();
+                _move_from(other);
+            }
+            return *this;
+        }
+
+        dense_map(const dense_map&) = delete;
+        dense_map& operator=(const dense_map&) = delete;
+
+        ~dense_map() { _destroy(); }
+
+        iterator end() { return nullptr; }
+
+        iterator find(const K& key) {
+            auto index = _index(key);
+            return index < N && _used[index] ? _at(index) : nullptr;
+        }
+
+        V& at(const K& key) {
+            auto found = find(key);
+            if (found == nullptr)
+                throw out_of_range("event has no handlers");
+            return found->second;
+        }
+
+        pair<iterator, bool> emplace(const K& key, V&& value) {
+            auto index = _index(key);
+            if (index >= N)
+                throw out_of_range("event key is not below its event_key_bound");
+            if (_used[index])
+                return make_pair(_at(index), false);
+
+            new (&_storage[index]) value_type(key, move(value));
+            _used[index] = true;
+            return make_pair(_at(index), true);
+        }
+
+        // Calls f with each entry, in key order.
+        template<typename F> void for_each(F&& f) {
+            for (size_t i = 0; i < N; ++i) {
+                if (_used[i])
+                    f(*_at(i));
+            }
+        }
+    };
+
+    // The characters of a string key, which std::string, string literals and std::string_view all convert to.
+    struct string_ref {
+        const char* data;
+        size_t size;
+
+        string_ref(const string& s) : data{s.data()}, size{s.size()} {}
+        string_ref(const char* s) : data{s}, size{strlen(s)} {}
+#if __cplusplus >= 201703L
+        string_ref(string_view s) : data{s.data()}, size{s.size()} {}
+#endif
+    };
+
+    // Hashing and comparison of event keys for hash_map. Keys are hashed again with a multiply and shift, since the
+    // std::hash of integers is often the identity, and the map uses the low bits.
+    template<typename K> struct key_ops {
+        static size_t hash(const K& key) {
+            auto h = static_cast<uint64_t>(hasher<K>()(key)) * 0x9e3779b97f4a7c15ull;
+            return static_cast<size_t>(h ^ h >> 32);
+        }
+        static bool equal(const K& a, const K& b) { return a == b; }
+    };
+    // Strings are hashed from their characters, so they can be looked up by anything that converts to string_ref.
+    template<> struct key_ops<string> {
+        static size_t hash(string_ref key) { return hash_bytes(key.data, key.size); }
+        static bool equal(const string& a, string_ref b) {
+            return a.size() == b.size && memcmp(a.data(), b.data, b.size) == 0;
+        }
+    };
+
+    // Whether a Q can be looked up in a map of K keys without constructing a K.
+    template<typename K, typename Q> struct is_lookup_key : false_type {};
+    template<typename Q> struct is_lookup_key<string, Q> :
+        integral_constant<bool, is_convertible<const Q&, string_ref>::value> {};
+
+    // An open addressing hash map of event keys to values, which never erases. Entries are kept in a deque, so they
+    // stay where they are as more are added. Like dense_map, it has the parts of the unordered_map interface which
+    // event_queue uses, and find also takes any key which key_ops can hash and compare, without converting it.
+    template<typename K, typename V> class hash_map {
+    public:
+        typedef pair<const K, V> value_type;
+        typedef value_type* iterator;
+
+    private:
+        resource_deque<value_type> _entries;
+        resource_vector<size_t> _hashes;
+        // Indexes into _entries plus 1, where 0 is an empty slot
+        resource_vector<uint32_t> _slots;
+
+        template<typename Q> size_t _probe(const Q& key, size_t hash) const {
+            auto mask = _slots.size() - 1;
+            for (auto slot = hash & mask;; slot = (slot + 1) & mask) {
+                auto index = _slots[slot];
+                if (index == 0 || (_hashes[index - 1] == hash && key_ops<K>::equal(_entries[index - 1].first, key)))
+                    return slot;
+            }
+        }
+
+        void _grow() {
+            auto slots = resource_vector<uint32_t>(_slots.size() * 2, 0, _slots.get_allocator());
+            auto mask = slots.size() - 1;
+            for (size_t index = 0; index < _hashes.size(); ++index) {
+                auto slot = _hashes[index] & mask;
+                while (slots[slot] != 0)
+                    slot = (slot + 1) & mask;
+                slots[slot] = static_cast<uint32_t>(index + 1);
+            }
+            _slots.swap(slots);
+        }
+
+    public:
+        hash_map() : hash_map(*eventus::default_resource()) {}
+        explicit hash_map(eventus::memory_resource& resource) :
+            _entries(resource), _hashes(resource), _slots(8, 0, resource) {}
+
+        iterator end() { return nullptr; }
+
+        template<typename Q> iterator find(const Q& key) {
+            auto index = _slots[_probe(key, key_ops<K>::hash(key))];
+            return index == 0 ? nullptr : &_entries[index - 1];
+        }
+
+        template<typename Q> V& at(const Q& key) {
+            auto found = find(key);
+            if (found == nullptr)
+                throw out_of_range("event has no handlers");
+            return found->second;
+        }
+
+        // Constructs the key from Q only if it isn't in the map already.
+        template<typename Q> pair<iterator, bool> emplace(const Q& key, V&& value) {
+            auto hash = key_ops<K>::hash(key);
+            auto slot = _probe(key, hash);
+            if (_slots[slot] != 0)
+                return make_pair(&_entries[_slots[slot] - 1], false);
+
+            _entries.emplace_back(piecewise_construct, forward_as_tuple(key), forward_as_tuple(move(value)));
+            _hashes.push_back(hash);
+            _slots[slot] = static_cast<uint32_t>(_entries.size());
+            if (_entries.size() * 2 > _slots.size())
+                _grow();
+            return make_pair(&_entries.back(), true);
+        }
+
+        // Calls f with each entry, in the order they were added.
+        template<typename F> void for_each(F&& f) {
+            for (auto& entry : _entries)
+                f(entry);
+        }
+    };
+
+    // Dense keys are stored in a dense_map, and anything else in a hash_map.
+    template<typename K, typename V> using event_map = typename conditional<
+        (eventus::event_key_bound<K>::value > 0),
+        dense_map<K, V, eventus::event_key_bound<K>::value>,
+        hash_map<K, V>>::type;
+
+    // A move-only callable which stores small callables in an inline buffer instead of on the heap.
+    template<typename S, size_t Size = EVENTUS_DELEGATE_SIZE> class delegate;
+
+    template<typename R, typename...Args, size_t Size>
+    class delegate<R(Args...), Size> {
+    private:
+        static_assert(Size >= sizeof(void*), "delegate buffer must be able to hold a pointer");
+
+        typedef typename aligned_storage<Size>::type storage_t;
+        typedef R(*invoke_t)(storage_t*, Args&&...);
+        // Moves the callable in src to dest and destroys the one in src. Only destroys it when dest is null.
+        typedef void(*manage_t)(storage_t* dest, storage_t* src);
+
+        template<typename F> struct is_inline : integral_constant<bool,
+            sizeof(F) <= Size && alignof(storage_t) % alignof(F) == 0 && is_nothrow_move_constructible<F>::value> {};
+
+        // Whether the result of F is dropped, and R() (e.g. false) returned instead: when it returns nothing, or when R
+        // is bool and F returns anything but bool, so a handler returning an int or a string never consumes an event.
+        template<typename F, typename Result = typename decay<decltype(declval<F&>()(declval<Args>()...))>::type>
+        struct drops_result : integral_constant<bool, is_void<R>::value || is_void<Result>::value ||
+                                                      (is_same<R, bool>::value && !is_same<Result, bool>::value)> {};
+
+        template<typename F> static R call(F& f, true_type, Args&&... args) {
+            f(forward<Args>(args)...);
+            return R();
+        }
+        template<typename F> static R call(F& f, false_type, Args&&... args) { return f(forward<Args>(args)...); }
+
+        template<typename F> struct inline_ops {
+            static F* get(storage_t* s) { return reinterpret_cast<F*>(s); }
+            static R invoke(storage_t* s, Args&&... args) {
+                return call(*get(s), drops_result<F>(), forward<Args>(args)...);
+            }
+            static void manage(storage_t* dest, storage_t* src) {
+                if (dest != nullptr)
+                    new (dest) F(move(*get(src)));
+                get(src)->~F();
+            }
+        };
+
+        // The callable is allocated along with the resource it goes back to.
+        template<typename F> struct heap_block {
+            eventus::memory_resource* resource;
+            F f;
+
+            template<typename G> heap_block(eventus::memory_resource& r, G&& g) : resource{&r}, f(forward<G>(g)) {}
+        };
+
+        template<typename F> struct heap_ops {
+            static heap_block<F>*& get(storage_t* s) { return *reinterpret_cast<heap_block<F>**>(s); }
+            static R invoke(storage_t* s, Args&&... args) {
+                return call(get(s)->f, drops_result<F>(), forward<Args>(args)...);
+            }
+            static void manage(storage_t* dest, storage_t* src) {
+                if (dest != nullptr) {
+                    new (dest) heap_block<F>*(get(src));
+                    return;
+                }
+                auto block = get(src);
+                auto resource = block->resource;
+                block->~heap_block<F>();
+                resource->deallocate(block, sizeof(heap_block<F>), alignof(heap_block<F>));
+            }
+        };
+
+        template<typename F>
+        void init(F&& f, eventus::memory_resource&, true_type) {
+            typedef typename decay<F>::type functor;
+            new (&_storage) functor(forward<F>(f));
+            _invoke = &inline_ops<functor>::invoke;
+            _manage = &inline_ops<functor>::manage;
+        }
+
+        template<typename F>
+        void init(F&& f, eventus::memory_resource& resource, false_type) {
+            typedef heap_block<typename decay<F>::type> block;
+            auto memory = resource.allocate(sizeof(block), alignof(block));
+            try {
+                new (&_storage) block*(new (memory) block(resource, forward<F>(f)));
+            }
+            catch (...) {
+                resource.deallocate(memory, sizeof(block), alignof(block));
+                throw;
+            }
+            _invoke = &heap_ops<typename decay<F>::type>::invoke;
+            _manage = &heap_ops<typename decay<F>::type>::manage;
+        }
+
+        invoke_t _invoke;
+        manage_t _manage;
+        mutable storage_t _storage;
+
+    public:
+        delegate() noexcept : _invoke{nullptr}, _manage{nullptr} {}
+
+        template<typename F, typename = typename enable_if<!is_same<typename decay<F>::type, delegate>::value>::type>
+        delegate(F&& f) : delegate(forward<F>(f), *eventus::default_resource()) {}
+
+        // Callables which don't fit the buffer are allocated from resource.
+        template<typename F, typename = typename enable_if<!is_same<typename decay<F>::type, delegate>::value>::type>
+        delegate(F&& f, eventus::memory_resource& resource) : _invoke{nullptr}, _manage{nullptr} {
+            init(forward<F>(f), resource, is_inline<typename decay<F>::type>());
+        }
+
+        delegate(delegate&& other) noexcept : _invoke{other._invoke}, _manage{other._manage} {
+            if (_manage != nullptr)
+                _manage(&_storage, &other._storage);
+            other._invoke = nullptr;
+            other._manage = nullptr;
+        }
+
+        delegate& operator=(delegate&& other) noexcept {
+            if (this != &other) {
+                reset();
+                if (other._manage != nullptr)
+                    other._manage(&_storage, &other._storage);
+                _invoke = other._invoke;
+                _manage = other._manage;
+                other._invoke = nullptr;
+                other._manage = nullptr;
+            }
+            return *this;
+        }
+
+        delegate(const delegate&) = delete;
+        delegate& operator=(const delegate&) = delete;
+
+        ~delegate() { reset(); }
+
+        void reset() noexcept {
+            if (_manage != nullptr)
+                _manage(nullptr, &_storage);
+            _invoke = nullptr;
+            _manage = nullptr;
+        }
+
+        explicit operator bool() const noexcept { return _invoke != nullptr; }
+
+        R operator()(Args... args) const { return _invoke(&_storage, forward<Args>(args)...); }
+    };
+
+    template<typename T, typename ENABLE = void> struct handler_ts { typedef function<void(T)> type; };
+    template<typename T> struct handler_ts<T, typename enable_if<is_void<T>::value>::type> {
+        typedef function<void()> type;
+    };
+    template<typename T> using handler_t = typename handler_ts<T>::type;
+
+    // The type an event's handlers are stored under. Handlers taking T, const T& and so on share the same storage.
+    template<typename T> using payload_t = typename decay<T>::type;
+
+    // The payload type of a fired argument of type A: T when it is given, as in fire<int>(event, i), otherwise the
+    // argument's own type. Keeping them apart lets an lvalue be fired with its type given.
+    struct deduced {};
+    template<typename T, typename A>
+    using fired_t = payload_t<typename conditional<is_same<T, deduced>::value, A, T>::type>;
+
+    // Handlers are always called with a const reference to the payload, so it is never copied for handlers which
+    // take a const reference. They return true to stop the event; handlers which return nothing return false.
+    template<typename T, typename ENABLE = void> struct delegate_ts { typedef delegate<bool(const T&)> type; };
+    template<typename T> struct delegate_ts<T, typename enable_if<is_void<T>::value>::type> {
+        typedef delegate<bool()> type;
+    };
+    template<typename T> using delegate_t = typename delegate_ts<T>::type;
+
+    template<typename T> struct invoke_ts {
+        static bool invoke(const delegate_t<T>& h, const T* p) { return h(*p); }
+    };
+    template<> struct invoke_ts<void> {
+        static bool invoke(const delegate_t<void>& h, const void*) { return h(); }
+    };
+
+    template<size_t... Is> struct index_list {};
+    template<size_t N, size_t... Is> struct make_index_list : make_index_list<N - 1, N - 1, Is...> {};
+    template<size_t... Is> struct make_index_list<0, Is...> { typedef index_list<Is...> type; };
+
+    // The payload of an event with several parameters. It only holds references to the fired arguments, which
+    // handlers are called with one by one, so none of them are copied.
+    template<typename... Ts> struct arguments {
+        static constexpr int size = sizeof...(Ts);
+
+        explicit arguments(const Ts&... values) : refs(values...) {}
+        // Refers to the values queued by event_queue::enqueue
+        explicit arguments(const tuple<Ts...>& values) :
+            arguments(values, typename make_index_list<sizeof...(Ts)>::type()) {}
+
+        tuple<const Ts&...> refs;
+
+    private:
+        template<size_t... Is>
+        arguments(const tuple<Ts...>& values, index_list<Is...>) : refs(get<Is>(values)...) {}
+    };
+    template<typename... Ts> using arguments_t = arguments<payload_t<Ts>...>;
+
+    template<typename T> struct is_arguments : false_type {};
+    template<typename... Ts> struct is_arguments<arguments<Ts...>> : true_type {};
+
+    template<typename... Ts> struct delegate_ts<arguments<Ts...>> { typedef delegate<bool(const Ts&...)> type; };
+
+    template<typename... Ts> struct invoke_ts<arguments<Ts...>> {
+        static bool invoke(const delegate_t<arguments<Ts...>>& h, const arguments<Ts...>* p) {
+            return call(h, *p, typename make_index_list<sizeof...(Ts)>::type());
+        }
+
+        template<size_t... Is>
+        static bool call(const delegate_t<arguments<Ts...>>& h, const arguments<Ts...>& p, index_list<Is...>) {
+            return h(get<Is>(p.refs)...);
+        }
+    };
+
+    // Where a handler is stored, which its handler_info points at. Removing the handler bumps the generation, so
+    // every copy of the handler_info sees the removal, and the ref can then be reused for another handler.
+    struct slot_ref {
+        atomic<size_t> generation;
+        size_t position;
+        bool pending;
+
+        slot_ref() : generation(1), position{0}, pending{false} {}
+    };
+
+    // The slot_refs of one event. They are kept in a deque, so the references to them stay valid as more are added.
+    class slot_refs {
+    private:
+        resource_deque<slot_ref> _refs;
+        resource_vector<slot_ref*> _free;
+
+    public:
+        slot_refs() : slot_refs(*eventus::default_resource()) {}
+        explicit slot_refs(eventus::memory_resource& resource) : _refs(resource), _free(resource) {}
+        slot_refs(slot_refs&&) = default;
+
+        slot_ref& acquire() {
+            if (_free.empty()) {
+                // Keeps room to release every ref, so removing a handler never allocates
+                if (_free.capacity() <= _refs.size())
+                    _free.reserve(max(_refs.size() + 1, 2 * _free.capacity()));
+                _refs.emplace_back();
+                return _refs.back();
+            }
+            auto& ref = *_free.back();
+            _free.pop_back();
+            return ref;
+        }
+
+        void release(slot_ref& ref) {
+            ref.generation.fetch_add(1, memory_order_release);
+            _free.push_back(&ref);
+        }
+    };
+
+    // An event handler and the slot_ref its handler_info uses to find it.
+    template<typename T> struct handler_slot {
+        slot_ref* ref;
+        bool live;
+        int priority;
+        delegate_t<T> fn;
+
+#ifdef EVENTUS_METRICS
+        eventus::latency_histogram latency;
+#endif
+
+        handler_slot(slot_ref& r, delegate_t<T>&& f, int p) : ref{&r}, live{true}, priority{p}, fn{move(f)} {}
+        handler_slot(handler_slot&& other) noexcept :
+            ref{other.ref}, live{other.live}, priority{other.priority}, fn{move(other.fn)} {
+#ifdef EVENTUS_METRICS
+            latency = other.latency;
+#endif
+            other.live = false;
+        }
+        handler_slot& operator=(handler_slot&& other) noexcept {
+            ref = other.ref;
+            live = other.live;
+            priority = other.priority;
+            fn = move(other.fn);
+#ifdef EVENTUS_METRICS
+            latency = other.latency;
+#endif
+            other.live = false;
+            return *this;
+        }
+    };
+
+    // Every handler attached to one event. Handlers added while the event is being dispatched are held in pending
+    // until the outermost dispatch returns, so the slots being iterated are never reallocated. Handlers running on a
+    // worker_pool (async_depth) pin the slots the same way, until the owning thread finds them all finished. Pending
+    // handlers are only ever appended while pinned, so a dispatch calls the ones which were pending when it started.
+    //
+    // Each handler's slot_ref holds its current position, in slots or in pending, which makes removal O(1).
+    //
+    // The slots are kept in the order they are called: by priority, highest first, and then in the order they were
+    // added. Handlers are inserted at their place when they are added (or merged from pending), so dispatch is a plain
+    // scan. Adding a handler of the lowest priority so far is an append; any other priority shifts the slots after it.
+    //
+    // Removed slots are left as tombstones, and erased together once they make up half of the slots, so removal
+    // stays amortized O(1) however the handlers churn. Handlers removed while the table is pinned are still alive
+    // (they may be running), so their positions are kept and they are destroyed as soon as it is idle again, while
+    // their slots wait for the tombstones to be erased like any other.
+    template<typename T> struct handler_table {
+        resource_vector<handler_slot<T>> slots;
+        resource_deque<handler_slot<T>> pending;
+        slot_refs refs;
+        size_t tombstones;
+        // The positions of the slots removed while pinned. Has room for every slot, so removal never allocates.
+        resource_vector<size_t> removed_pinned;
+        int depth;
+        atomic<int> async_depth;
+#ifdef EVENTUS_METRICS
+        uint64_t fires = 0;
+        uint64_t invoked = 0;
+#endif
+#ifdef EVENTUS_TRACE
+        // The name of the event in traces, interned by the trace_log
+        const char* trace_name = "event";
+#endif
+
+        handler_table() : handler_table(*eventus::default_resource()) {}
+        explicit handler_table(eventus::memory_resource& resource) :
+            slots(resource), pending(resource), refs(resource),
+            tombstones{0}, removed_pinned(resource), depth{0}, async_depth(0) {}
+        handler_table(handler_table&& other) :
+            slots(move(other.slots)),
+            pending(move(other.pending)),
+            refs(move(other.refs)),
+            tombstones{other.tombstones},
+            removed_pinned(move(other.removed_pinned)),
+            depth{other.depth},
+            async_depth(other.async_depth.load()) {
+#ifdef EVENTUS_METRICS
+            fires = other.fires;
+            invoked = other.invoked;
+#endif
+#ifdef EVENTUS_TRACE
+            trace_name = other.trace_name;
+#endif
+        }
+
+        // Whether the slots may be reallocated and removed handlers destroyed.
+        bool idle() const { return depth == 0 && async_depth.load(memory_order_acquire) == 0; }
+
+        // Makes room for count more slots, so inserting them doesn't allocate.
+        void reserve(size_t count) {
+            auto size = slots.size() + count;
+            if (size > slots.capacity())
+                slots.reserve(max(size, 2 * slots.capacity()));
+            if (removed_pinned.capacity() < slots.capacity())
+                removed_pinned.reserve(slots.capacity());
+        }
+
+        // Merges the pending handlers and erases the tombstones which are due. Only called while idle. Room for the
+        // pending handlers is made before any of them is merged, so if that throws they are all left pending.
+        void settle() {
+            for (auto position : removed_pinned)
+                slots[position].fn.reset();
+            removed_pinned.clear();
+            if (tombstones * 2 > slots.size()) {
+                size_t kept = 0;
+                for (auto& slot : slots) {
+                    if (!slot.live)
+                        continue;
+                    slot.ref->position = kept;
+                    if (&slots[kept] != &slot)
+                        slots[kept] = move(slot);
+                    ++kept;
+                }
+                slots.erase(slots.begin() + kept, slots.end());
+                tombstones = 0;
+            }
+            if (pending.empty())
+                return;
+            reserve(pending.size());
+            for (auto& slot : pending) {
+                if (!slot.live)
+                    continue;
+                slot.ref->pending = false;
+                insert(move(slot));
+            }
+            pending.clear();
+        }
+
+        // Inserts slot after every slot of the same or a higher priority. Only called while idle, after reserve.
+        void insert(handler_slot<T>&& slot) {
+            auto position = slots.size();
+            while (position > 0 && slots[position - 1].priority < slot.priority)
+                --position;
+
+            slots.emplace(slots.begin() + position, move(slot));
+            // The refs of removed slots may already belong to other handlers
+            for (auto i = position; i < slots.size(); ++i) {
+                if (slots[i].live)
+                    slots[i].ref->position = i;
+            }
+        }
+
+        template<typename F> slot_ref& add(F&& f, int priority) {
+            auto& resource = *slots.get_allocator().resource;
+            auto is_idle = idle();
+            if (is_idle) {
+                settle();
+                reserve(1);
+            }
+            auto& ref = refs.acquire();
+            if (is_idle) {
+                ref.pending = false;
+                insert(handler_slot<T>(ref, delegate_t<T>(forward<F>(f), resource), priority));
+            }
+            else {
+                ref.position = pending.size();
+                ref.pending = true;
+                pending.emplace_back(ref, delegate_t<T>(forward<F>(f), resource), priority);
+            }
+            return ref;
+        }
+
+        // Removes the handler stored at ref, which must be live.
+        void remove(slot_ref& ref) {
+            auto is_idle = idle();
+            refs.release(ref);
+            if (ref.pending) {
+                pending[ref.position].live = false;
+                return;
+            }
+
+            // A handler may remove itself while it is running, so it is only destroyed outside of dispatch
+            auto& slot = slots[ref.position];
+            slot.live = false;
+            ++tombstones;
+            if (!is_idle) {
+                removed_pinned.push_back(ref.position);
+                return;
+            }
+            slot.fn.reset();
+            settle();
+        }
+
+#ifdef EVENTUS_METRICS
+        // Appends the counters of every live handler, in the order they are called.
+        void collect(vector<eventus::handler_metrics>& out) const {
+            for (const auto& slot : slots) {
+                if (slot.live)
+                    out.push_back({ slot.priority, slot.latency });
+            }
+            for (const auto& slot : pending) {
+                if (slot.live)
+                    out.push_back({ slot.priority, slot.latency });
+            }
+        }
+
+        void reset_metrics() {
+            fires = 0;
+            invoked = 0;
+            for (auto& slot : slots)
+                slot.latency.reset();
+            for (auto& slot : pending)
+                slot.latency.reset();
+        }
+#endif
+    };
+
+    template<typename T> class dispatch_guard {
+    private:
+        handler_table<T>& _table;
+
+    public:
+        dispatch_guard(handler_table<T>& table) : _table(table) {
+            if (_table.idle())
+                _table.settle();
+            ++_table.depth;
+        }
+        dispatch_guard(const dispatch_guard&) = delete;
+        dispatch_guard& operator=(const dispatch_guard&) = delete;
+
+        ~dispatch_guard() {
+            --_table.depth;
+            if (!_table.idle())
+                return;
+            try {
+                _table.settle();
+            }
+            catch (...) {
+                // Out of memory: the handlers added while firing stay pending, and are merged by the next settle
+            }
+        }
+    };
+
+    // The index of E in Es, for looking up the handlers of a static_event_queue.
+    template<typename E, typename... Es> struct index_of;
+    template<typename E, typename... Es> struct index_of<E, E, Es...> : integral_constant<size_t, 0> {};
+    template<typename E, typename F, typename... Es> struct index_of<E, F, Es...> :
+        integral_constant<size_t, 1 + index_of<E, Es...>::value> {};
+    template<typename E> struct index_of<E> {
+        static_assert(sizeof(E) == 0, "The event is not one of the events of this static_event_queue");
+    };
+
+    template<typename E> using event_payload_t = payload_t<typename E::payload>;
+
+    // Calls one handler through d. The call is timed when EVENTUS_METRICS is defined, and traced when EVENTUS_TRACE
+    // is.
+    template<typename T>
+    bool call_slot(handler_table<T>& table, handler_slot<T>& slot, bool(*d)(const delegate_t<T>&,const T*),
+                   const T* param) {
+#ifdef EVENTUS_TRACE
+        trace_span span(table.trace_name, type_name<T>(), true);
+#endif
+#ifdef EVENTUS_METRICS
+        ++table.invoked;
+        auto start = chrono::steady_clock::now();
+        auto consumed = (*d)(slot.fn, param);
+        auto elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start);
+        // The slot stays put while the table is pinned, though the handler may have removed itself
+        slot.latency.record(static_cast<uint64_t>(elapsed.count()));
+        return consumed;
+#else
+        (void)table;
+        return (*d)(slot.fn, param);
+#endif
+    }
+
+    // Calls the handlers of one event through d, including the ones which were pending when it started, until one of
+    // them returns true.
+    template<typename T>
+    void dispatch(handler_table<T>& table, bool(*d)(const delegate_t<T>&,const T*), const T* param) {
+#ifdef EVENTUS_METRICS
+        ++table.fires;
+#endif
+        if (table.slots.empty() && table.pending.empty())
+            return;
+
+#ifdef EVENTUS_TRACE
+        trace_span span(table.trace_name, type_name<T>(), false);
+#endif
+        dispatch_guard<T> guard(table);
+        auto num_pending = table.pending.size();
+        for (auto& slot : table.slots) {
+            if (slot.live && call_slot(table, slot, d, param))
+                return;
+        }
+        for (size_t i = 0; i < num_pending; ++i) {
+            if (table.pending[i].live && call_slot(table, table.pending[i], d, param))
+                return;
+        }
+    }
+
+    // Calls one handler on a worker_pool, pinning its handler_table until the call is destroyed.
+    template<typename T> class async_call {
+    private:
+        handler_table<T>* _table;
+        const delegate_t<T>* _fn;
+        shared_ptr<const T> _payload;
+
+    public:
+        async_call(handler_table<T>& table, const delegate_t<T>& fn, const shared_ptr<const T>& payload) :
+            _table{&table}, _fn{&fn}, _payload{payload} {
+            _table->async_depth.fetch_add(1, memory_order_relaxed);
+        }
+
+        async_call(async_call&& other) noexcept :
+            _table{other._table}, _fn{other._fn}, _payload{move(other._payload)} {
+            other._table = nullptr;
+        }
+
+        async_call(const async_call&) = delete;
+        async_call& operator=(const async_call&) = delete;
+
+        ~async_call() {
+            if (_table != nullptr)
+                _table->async_depth.fetch_sub(1, memory_order_release);
+        }
+
+        // The handlers of an asynchronous fire run side by side, so they can't stop each other
+        void operator()() { invoke_ts<T>::invoke(*_fn, _payload.get()); }
+    };
+
+    template<typename T>
+    constexpr typename enable_if<!is_void<T>::value && !is_arguments<T>::value, int>::type get_num_params() {
+        return 1;
+    }
+    template<typename T>
+    constexpr typename enable_if<is_arguments<T>::value, int>::type get_num_params() { return T::size; }
+    template<typename T>
+    constexpr typename enable_if<is_void<T>::value, int>::type get_num_params() { return 0; }
+    template<typename T, typename S, typename...Ts>
+    constexpr int get_num_params() { return sizeof...(Ts) + 2; }
+
+    class handlers : private any_t {
+    private:
+        handlers(any_t&& a, int p) : any_t(move(a)), NUM_PARAMS{p} {};
+
+    public:
+        const int NUM_PARAMS;
+        template<typename T> static handlers create(eventus::memory_resource& resource);
+        template<typename T> handler_table<T>& get();
+
+#ifdef EVENTUS_METRICS
+    private:
+        // Reach the handler_table without knowing its type, for event_queue::metrics
+        void(*_collect)(handlers& h, uint64_t& fires, uint64_t& invoked, vector<eventus::handler_metrics>& out);
+        void(*_reset)(handlers& h);
+
+        template<typename T>
+        static void collect(handlers& h, uint64_t& fires, uint64_t& invoked, vector<eventus::handler_metrics>& out) {
+            auto& table = h.get<T>();
+            fires = table.fires;
+            invoked = table.invoked;
+            table.collect(out);
+        }
+        template<typename T> static void reset(handlers& h) { h.get<T>().reset_metrics(); }
+
+    public:
+        void collect(uint64_t& fires, uint64_t& invoked, vector<eventus::handler_metrics>& out) {
+            _collect(*this, fires, invoked, out);
+        }
+        void reset_metrics() { _reset(*this); }
+#endif
+    };
+
+    template<typename T>
+    handlers handlers::create(eventus::memory_resource& resource) {
+        auto h = handlers(any_t::create(handler_table<T>(resource), resource), get_num_params<T>());
+#ifdef EVENTUS_METRICS
+        h._collect = &collect<T>;
+        h._reset = &reset<T>;
+#endif
+        return h;
+    }
+
+    template<typename T>
+    handler_table<T>& handlers::get() {
+        try {
+            return any_t::cast<handler_table<T>>(*this);
+        }
+        catch (const bad_cast&) {
+            if (get_num_params<T>() == NUM_PARAMS)
+                throw;
+            throw invalid_argument("Previous operations on this event type used a different number of arguments");
+        }
+    }
+
+    // A FIFO of events waiting to be dispatched. Payloads of every type are packed into one contiguous block, which is
+    // kept between dispatches so that a steady stream of events doesn't allocate.
+    template<typename event_type> class event_buffer {
+    public:
+        typedef void(*dispatch_t)(handlers& h, const void* payload);
+        // Moves the payload in src to dest and destroys the one in src. Only destroys it when dest is null.
+        typedef void(*relocate_t)(void* dest, void* src);
+
+        struct record {
+            event_type event;
+            dispatch_t dispatch;
+            relocate_t relocate;
+            size_t offset;
+        };
+
+    private:
+        typedef typename aligned_storage<2 * sizeof(void*)>::type unit_t;
+
+        template<typename P> static void relocate(void* dest, void* src) {
+            auto p = static_cast<P*>(src);
+            if (dest != nullptr)
+                new (dest) P(move(*p));
+            p->~P();
+        }
+
+        template<typename P> static size_t units() { return (sizeof(P) + sizeof(unit_t) - 1) / sizeof(unit_t); }
+
+        void reserve(size_t capacity) {
+            if (capacity <= _capacity)
+                return;
+
+            auto new_capacity = max(capacity, max(2 * _capacity, size_t(64)));
+            auto new_payloads = static_cast<unit_t*>(_resource->allocate(new_capacity * sizeof(unit_t),
+                                                                         alignof(unit_t)));
+            for (auto& r : _records) {
+                if (r.relocate != nullptr)
+                    r.relocate(&new_payloads[r.offset], &_payloads[r.offset]);
+            }
+            release();
+            _payloads = new_payloads;
+            _capacity = new_capacity;
+        }
+
+        // Frees the payload block, which must be empty.
+        void release() {
+            if (_payloads != nullptr)
+                _resource->deallocate(_payloads, _capacity * sizeof(unit_t), alignof(unit_t));
+            _payloads = nullptr;
+            _capacity = 0;
+        }
+
+        void destroy(size_t begin, size_t end) {
+            for (auto i = begin; i < end; ++i) {
+                if (_records[i].relocate != nullptr)
+                    _records[i].relocate(nullptr, payload(i));
+            }
+        }
+
+        resource_vector<record> _records;
+        eventus::memory_resource* _resource;
+        unit_t* _payloads;
+        size_t _capacity;
+        size_t _used;
+
+    public:
+        explicit event_buffer(eventus::memory_resource& resource) :
+            _records(resource), _resource{&resource}, _payloads{nullptr}, _capacity{0}, _used{0} {}
+
+        // The buffer left behind stays with the same resource
+        event_buffer(event_buffer&& other) noexcept :
+            _records(move(other._records)),
+            _resource{other._resource},
+            _payloads{other._payloads},
+            _capacity{other._capacity},
+            _used{other._used} {
+            other._records.clear();
+            other._payloads = nullptr;
+            other._capacity = 0;
+            other._used = 0;
+        }
+
+        // Takes the resource of other along with its payload block, so the block is freed where it came from
+        event_buffer& operator=(event_buffer&& other) noexcept {
+            if (this != &other) {
+                clear();
+                release();
+                _records = move(other._records);
+                _resource = other._resource;
+                _payloads = other._payloads;
+                _capacity = other._capacity;
+                _used = other._used;
+                other._records.clear();
+                other._payloads = nullptr;
+                other._capacity = 0;
+                other._used = 0;
+            }
+            return *this;
+        }
+
+        ~event_buffer() {
+            clear();
+            release();
+        }
+
+        template<typename P, typename...Args>
+        typename enable_if<!is_void<P>::value>::type push(event_type&& event, dispatch_t d, Args&&... args) {
+            static_assert(alignof(P) <= alignof(unit_t), "over-aligned event parameters cannot be queued");
+
+            if (_records.size() == _records.capacity())
+                _records.reserve(max(2 * _records.size(), size_t(16)));
+            reserve(_used + units<P>());
+
+            new (&_payloads[_used]) P(forward<Args>(args)...);
+            _records.push_back(record { forward<event_type>(event), d, &relocate<P>, _used });
+            _used += units<P>();
+        }
+
+        template<typename P>
+        typename enable_if<is_void<P>::value>::type push(event_type&& event, dispatch_t d) {
+            _records.push_back(record { forward<event_type>(event), d, nullptr, _used });
+        }
+
+        size_t size() const { return _records.size(); }
+        bool empty() const { return _records.empty(); }
+        record& at(size_t i) { return _records[i]; }
+        void* payload(size_t i) { return &_payloads[_records[i].offset]; }
+
+        // Removes the first count records, leaving the payloads of the rest where they are.
+        void erase_front(size_t count) {
+            if (count == _records.size()) {
+                clear();
+                return;
+            }
+            destroy(0, count);
+            _records.erase(_records.begin(), _records.begin() + count);
+        }
+
+        // Moves every record of other to the end of this buffer.
+        void append(event_buffer&& other) {
+            for (size_t i = 0; i < other.size(); ++i) {
+                auto& r = other.at(i);
+                auto size = i + 1 < other.size() ? other.at(i + 1).offset - r.offset : other._used - r.offset;
+                reserve(_used + size);
+                if (r.relocate != nullptr)
+                    r.relocate(&_payloads[_used], other.payload(i));
+                _records.push_back(record { move(r.event), r.dispatch, r.relocate, _used });
+                _used += size;
+            }
+            other._records.clear();
+            other._used = 0;
+        }
+
+        void clear() {
+            destroy(0, _records.size());
+            _records.clear();
+            _used = 0;
+        }
+    };
+
+    // Puts the events left over by event_queue::drain back in front of the ones queued while it was dispatching. A
+    // buffer which ends up empty becomes the spare, so its payload block is handed to the queue by the next drain.
+    // Left over events are copied to the start of another block rather than kept where they are, so a queue which is
+    // never drained completely doesn't creep along its payload block.
+    template<typename event_type> class drain_guard {
+    private:
+        event_buffer<event_type>& _batch;
+        event_buffer<event_type>& _queue;
+        event_buffer<event_type>& _spare;
+        const size_t& _consumed;
+
+    public:
+        drain_guard(event_buffer<event_type>& batch, event_buffer<event_type>& queue, event_buffer<event_type>& spare,
+                    const size_t& consumed) :
+            _batch(batch), _queue(queue), _spare(spare), _consumed(consumed) {}
+        drain_guard(const drain_guard&) = delete;
+        drain_guard& operator=(const drain_guard&) = delete;
+
+        ~drain_guard() {
+            _batch.erase_front(_consumed);
+            if (_batch.empty()) {
+                // If nothing was queued, the queue keeps the block of the batch, which has grown to fit it
+                if (_queue.empty()) {
+                    _spare = move(_queue);
+                    _queue = move(_batch);
+                }
+                else {
+                    _spare = move(_batch);
+                }
+                return;
+            }
+
+            if (_queue.empty()) {
+                _queue.append(move(_batch));
+                _spare = move(_batch);
+                return;
+            }
+            _spare.append(move(_batch));
+            _spare.append(move(_queue));
+            _batch = move(_queue);
+            _queue = move(_spare);
+            _spare = move(_batch);
+        }
+    };
+
+    // The latest parameter posted for one event of a coalescing_queue. It is taken out while the event is fired, and
+    // put back afterwards unless a handler posted the event again, so it is kept between dispatches and posting the
+    // event again assigns to it rather than allocating. fire is null until the event is first posted.
+    template<typename event_type> struct coalesced {
+        typedef void(*fire_t)(eventus::event_queue<event_type>& queue, const event_type& event, coalesced& slot);
+
+        any_t payload;
+        fire_t fire;
+        bool posted;
+
+        coalesced() : fire{nullptr}, posted{false} {}
+    };
+
+    inline size_t round_up_pow2(size_t n) {
+        size_t result = 1;
+        while (result < n)
+            result <<= 1;
+        return result;
+    }
+
+    // Lets threads read shared state without locks while writers replace it (a simple form of RCU). Each reader counts
+    // itself on a stripe picked per thread, under the parity of the current epoch, so readers on different threads
+    // don't contend for the same cache line. Writers flip the epoch and wait for the old parity to drain.
+    class read_domain {
+    private:
+        static const size_t STRIPES = 64;
+
+        struct stripe {
+            atomic<size_t> readers[2];
+            char padding[128 - 2 * sizeof(atomic<size_t>)];
+        };
+
+        static size_t stripe_index() {
+            static atomic<size_t> next(0);
+            static thread_local size_t index = next.fetch_add(1) % STRIPES;
+            return index;
+        }
+
+        stripe _stripes[STRIPES];
+        atomic<size_t> _epoch;
+        mutex _synchronize;
+
+    public:
+        read_domain() : _epoch(0) {
+            for (auto& s : _stripes) {
+                s.readers[0].store(0);
+                s.readers[1].store(0);
+            }
+        }
+
+        // Number of read sections, of any domain, the calling thread is inside of.
+        static int& depth() {
+            static thread_local int d = 0;
+            return d;
+        }
+
+        // Returns a token to pass to exit.
+        size_t enter() {
+            auto index = stripe_index();
+            for (;;) {
+                auto epoch = _epoch.load();
+                auto parity = epoch & 1;
+                _stripes[index].readers[parity].fetch_add(1);
+                if (_epoch.load() == epoch) {
+                    ++depth();
+                    return 2 * index + parity;
+                }
+                _stripes[index].readers[parity].fetch_sub(1);
+            }
+        }
+
+        void exit(size_t token) {
+            --depth();
+            _stripes[token / 2].readers[token % 2].fetch_sub(1, memory_order_release);
+        }
+
+        // Waits until every read section entered before the call has been exited. Deadlocks if called from inside a
+        // read section.
+        void synchronize() {
+            lock_guard<mutex> lock(_synchronize);
+            for (auto i = 0; i < 2; ++i) {
+                auto parity = _epoch.fetch_add(1) & 1;
+                for (auto& s : _stripes) {
+                    while (s.readers[parity].load(memory_order_acquire) != 0)
+                        this_thread::yield();
+                }
+            }
+        }
+    };
+
+    class read_section {
+    private:
+        read_domain& _domain;
+        size_t _token;
+
+    public:
+        read_section(read_domain& domain) : _domain(domain), _token{domain.enter()} {}
+        read_section(const read_section&) = delete;
+        read_section& operator=(const read_section&) = delete;
+        ~read_section() { _domain.exit(_token); }
+    };
+
+    // A handler of a concurrent_event_queue. It is shared by every snapshot of the handler list it belongs to.
+    template<typename T> struct shared_handler {
+        const slot_ref* ref;
+        atomic<bool> removed;
+        const int priority;
+        delegate_t<T> fn;
+
+        shared_handler(delegate_t<T>&& f, int p) : ref{nullptr}, removed(false), priority{p}, fn{move(f)} {}
+    };
+
+    template<typename T> using handler_snapshot = vector<shared_ptr<shared_handler<T>>>;
+
+    // One event of a concurrent_event_queue. Readers load the published snapshot, writers replace it.
+    struct concurrent_entry {
+        const type_id_t type;
+        const int NUM_PARAMS;
+        atomic<const void*> snapshot;
+        shared_ptr<void> owner;
+        slot_refs refs;
+
+        concurrent_entry(type_id_t t, int p, shared_ptr<void>&& s) :
+            type{t}, NUM_PARAMS{p}, snapshot(s.get()), owner{move(s)} {}
+
+        template<typename T> void check() const {
+            if (type == type_id<T>())
+                return;
+            if (get_num_params<T>() == NUM_PARAMS)
+                throw bad_cast();
+            throw invalid_argument("Previous operations on this event type used a different number of arguments");
+        }
+    };
+}
+
+namespace eventus {
+    using namespace std;
+    using _eventus_util::handlers;
+    using _eventus_util::handler_table;
+    using _eventus_util::delegate_t;
+    using _eventus_util::payload_t;
+    using _eventus_util::fired_t;
+    using _eventus_util::arguments;
+    using _eventus_util::arguments_t;
+
+    /// Alias for `std::function<void(T)>` or `std::function<void()>`.
+    template<typename T> using handler = _eventus_util::handler_t<T>;
+
+#ifdef EVENTUS_TRACE
+    /*! @brief Writes the spans recorded on every thread to a file, as Chrome Trace Event JSON, which
+     *  `chrome://tracing` and Perfetto open. Only defined with @ref EVENTUS_TRACE.
+     *
+     *  Each fire of an event with handlers, and each handler call, is a span named after the event (see
+     *  @ref event_name). Its arguments are the parameter type and the number of fires it is nested in. Fires of
+     *  `event_queue`, `static_event_queue` and channels are recorded, including queued events when they are
+     *  dispatched, but not the handlers run by `event_queue::fire_async`. Recording a span doesn't lock: each thread
+     *  records into its own buffer of @ref EVENTUS_TRACE_BUFFER_SIZE spans.
+     *
+     *  It may be called while other threads are firing events; spans still in progress are left out.
+     *
+     *  @return false if the file couldn't be written.
+     */
+    inline bool write_trace(const std::string& path) { return _eventus_util::trace_log::instance().write(path); }
+
+    /// Discards the spans recorded so far. It must not be called while any thread is firing events.
+    inline void clear_trace() { _eventus_util::trace_log::instance().clear(); }
+#endif
+
+    template<typename event_type, typename T>
+    class handler_info {
+
+    friend event_queue<event_type>;
+    friend concurrent_event_queue<event_type>;
+    template<typename...> friend class static_event_queue;
+
+    private:
+        const event_type _event;
+        _eventus_util::slot_ref* _ref;
+        size_t _generation;
+
+        void check() const {
+            if (removed())
+                throw handler_removed();
+        }
+
+        handler_info(const event_type& event, _eventus_util::slot_ref& ref, size_t generation) :
+            _event(event),
+            _ref{&ref},
+            _generation{generation} {}
+
+    public:
+        /// Thrown when trying to remove an event handler which no longer exists.
+        class handler_removed : exception {};
+
+        /// Gets the event the handler is attached to.
+        const event_type& event() const { return _event; }
+
+        /*! @brief Tests whether the event handler has been removed, through this or any other copy of the
+         *  `handler_info`.
+         *
+         *  Must not be called after the queue the handler was added to is destroyed.
+         */
+        bool removed() const { return _ref->generation.load(memory_order_acquire) != _generation; }
+    };
+
+    template<typename event_type, typename T>
+    class event_channel {
+
+    friend event_queue<event_type>;
+    template<typename...> friend class static_event_queue;
+
+    private:
+        handler_table<T>* _table;
+
+        event_channel(handler_table<T>& table) : _table{&table} {}
+
+    public:
+        /// Fires the event, passing along the parameter of type T to every handler attached to it.
+        void fire(const T& parameter) const;
+    };
+
+    template<typename event_type>
+    class event_channel<event_type, void> {
+
+    friend event_queue<event_type>;
+    template<typename...> friend class static_event_queue;
+
+    private:
+        handler_table<void>* _table;
+
+        event_channel(handler_table<void>& table) : _table{&table} {}
+
+    public:
+        /// Fires the event with no parameter.
+        void fire() const;
+    };
+
+    template<typename event_type, typename... Ts>
+    class event_channel<event_type, arguments<Ts...>> {
+
+    friend event_queue<event_type>;
+
+    private:
+        handler_table<arguments<Ts...>>* _table;
+
+        event_channel(handler_table<arguments<Ts...>>& table) : _table{&table} {}
+
+    public:
+        /// Fires the event, passing along each of the parameters to every handler attached to it.
+        void fire(const Ts&... parameters) const;
+    };
+
+    class symbol {
+    public:
+        /// Creates the null symbol, which no string is interned as.
+        symbol() : _id{0} {}
+
+        /// Gets the id, which is 0 for the null symbol and counts up from 1 in the order strings were interned.
+        uint32_t id() const { return _id; }
+
+        /// Tests whether this is a symbol of an interned string, rather than the null symbol.
+        explicit operator bool() const { return _id != 0; }
+
+        bool operator==(const symbol& other) const { return _id == other._id; }
+        bool operator!=(const symbol& other) const { return _id != other._id; }
+        bool operator<(const symbol& other) const { return _id < other._id; }
+
+    private:
+        friend string_pool;
+
+        explicit symbol(uint32_t id) : _id{id} {}
+
+        uint32_t _id;
+    };
+
+    class string_pool {
+    public:
+        /*! @brief Creates an empty `string_pool`.
+         *
+         *  Interning a string gives it a @ref symbol, which an `event_queue<symbol>` can use as a much cheaper key than
+         *  the string: it is hashed and compared as an integer, and never allocates. Looking a string up with
+         *  @ref find, or interning one which is already in the pool, doesn't allocate either. The pool is not thread
+         *  safe.
+         */
+        string_pool() : _count{0}, _slots(16, 0) {}
+
+        /// Gets the symbol of the string, adding the string to the pool if needed.
+        symbol intern(const char* s, size_t length);
+        symbol intern(const char* s) { return intern(s, strlen(s)); }
+        symbol intern(const string& s) { return intern(s.data(), s.size()); }
+
+        /// Gets the symbol of the string, or the null symbol if it hasn't been interned.
+        symbol find(const char* s, size_t length) const;
+        symbol find(const char* s) const { return find(s, strlen(s)); }
+        symbol find(const string& s) const { return find(s.data(), s.size()); }
+
+#if __cplusplus >= 201703L
+        symbol intern(string_view s) { return intern(s.data(), s.size()); }
+        symbol find(string_view s) const { return find(s.data(), s.size()); }
+#endif
+
+        /*! @brief Gets the string a symbol was interned from.
+         *
+         *  @throws std::out_of_range The symbol doesn't belong to this pool.
+         */
+        const string& name(symbol sym) const;
+
+        /// Gets the number of strings in the pool.
+        size_t size() const { return _count; }
+
+    private:
+        // Finds the slot holding the string, or the empty slot where it would go.
+        size_t _probe(const char* s, size_t length, size_t hash) const;
+        void _grow();
+
+        // Names are kept in a deque, so the references name() returns stay valid as more are added.
+        deque<string> _names;
+        vector<size_t> _hashes;
+        size_t _count;
+        // An open addressing table of ids, where 0 is an empty slot
+        vector<uint32_t> _slots;
+    };
+
+    inline symbol string_pool::intern(const char* s, size_t length) {
+        auto hash = _eventus_util::hash_bytes(s, length);
+        auto slot = _probe(s, length, hash);
+        if (_slots[slot] != 0)
+            return symbol(_slots[slot]);
+
+        _names.emplace_back(s, length);
+        _hashes.push_back(hash);
+        _slots[slot] = static_cast<uint32_t>(++_count);
+        if (_count * 2 > _slots.size())
+            _grow();
+        return symbol(static_cast<uint32_t>(_count));
+    }
+
+    inline symbol string_pool::find(const char* s, size_t length) const {
+        return symbol(_slots[_probe(s, length, _eventus_util::hash_bytes(s, length))]);
+    }
+
+    inline const string& string_pool::name(symbol sym) const {
+        if (sym._id == 0 || sym._id > _count)
+            throw out_of_range("symbol is not in this string_pool");
+        return _names[sym._id - 1];
+    }
+
+    inline size_t string_pool::_probe(const char* s, size_t length, size_t hash) const {
+        auto mask = _slots.size() - 1;
+        for (auto slot = hash & mask;; slot = (slot + 1) & mask) {
+            auto id = _slots[slot];
+            if (id == 0)
+                return slot;
+            const auto& name = _names[id - 1];
+            if (_hashes[id - 1] == hash && name.size() == length && memcmp(name.data(), s, length) == 0)
+                return slot;
+        }
+    }
+
+    inline void string_pool::_grow() {
+        auto slots = vector<uint32_t>(_slots.size() * 2, 0);
+        auto mask = slots.size() - 1;
+        for (uint32_t id = 1; id <= _count; ++id) {
+            auto slot = _hashes[id - 1] & mask;
+            while (slots[slot] != 0)
+                slot = (slot + 1) & mask;
+            slots[slot] = id;
+        }
+        _slots.swap(slots);
+    }
+}
+
+namespace std {
+    template<> struct hash<eventus::symbol> {
+        size_t operator()(eventus::symbol sym) const { return sym.id(); }
+    };
+}
+
+#ifdef EVENTUS_TRACE
+namespace eventus {
+    template<> struct event_name<symbol> {
+        static std::string get(const symbol& event) { return "symbol " + std::to_string(event.id()); }
+    };
+}
+#endif
+
+namespace eventus {
+    class worker_pool {
+    public:
+        /*! @brief Starts a pool of worker threads.
+         *
+         *  Each worker has its own deque of tasks. Workers run their own newest task first, and steal the oldest task
+         *  of another worker when theirs is empty.
+         *
+         *  @param threads The number of worker threads. Defaults to the number of hardware threads.
+         */
+        explicit worker_pool(size_t threads = thread::hardware_concurrency());
+
+        /// Runs the tasks still queued, then stops the workers.
+        ~worker_pool();
+
+        worker_pool(const worker_pool&) = delete;
+        worker_pool& operator=(const worker_pool&) = delete;
+
+        /*! @brief Queues a callable to be run by a worker.
+         *
+         *  Called from a worker, the task goes to that worker's own deque.
+         */
+        template<typename F> void submit(F&& task);
+
+        /*! @brief Waits until every queued task has finished. Must not be called from a worker.
+         *
+         *  @throws Rethrows the first exception thrown by a task since the last call.
+         */
+        void wait();
+
+        /// Gets the number of worker threads.
+        size_t size() const { return _threads.size(); }
+
+    private:
+        typedef _eventus_util::delegate<void()> task;
+
+        struct worker {
+            mutex lock;
+            deque<task> tasks;
+        };
+
+        // The pool and index of the worker running on the calling thread, if any.
+        static const worker_pool*& current_pool() {
+            static thread_local const worker_pool* pool = nullptr;
+            return pool;
+        }
+        static size_t& current_index() {
+            static thread_local size_t index = 0;
+            return index;
+        }
+
+        bool _pop(size_t index, task& t);
+        void _run(size_t index);
+
+        vector<unique_ptr<worker>> _workers;
+        vector<thread> _threads;
+        mutex _lock;
+        condition_variable _wake;
+        condition_variable _idle;
+        atomic<size_t> _queued;
+        atomic<size_t> _unfinished;
+        atomic<size_t> _next;
+        bool _stop;
+        exception_ptr _error;
+    };
+
+    inline worker_pool::worker_pool(size_t threads) : _queued(0), _unfinished(0), _next(0), _stop{false} {
+        if (threads == 0)
+            threads = 1;
+        for (size_t i = 0; i < threads; ++i)
+            _workers.emplace_back(new worker());
+        for (size_t i = 0; i < threads; ++i)
+            _threads.emplace_back(&worker_pool::_run, this, i);
+    }
+
+    inline worker_pool::~worker_pool() {
+        {
+            lock_guard<mutex> lock(_lock);
+            _stop = true;
+        }
+        _wake.notify_all();
+        for (auto& t : _threads)
+            t.join();
+    }
+
+    template<typename F>
+    void worker_pool::submit(F&& f) {
+        auto t = task(forward<F>(f));
+        auto index = current_pool() == this ? current_index() : _next.fetch_add(1) % _workers.size();
+
+        _unfinished.fetch_add(1);
+        {
+            lock_guard<mutex> lock(_workers[index]->lock);
+            _workers[index]->tasks.push_back(move(t));
+        }
+        {
+            lock_guard<mutex> lock(_lock);
+            _queued.fetch_add(1);
+        }
+        _wake.notify_one();
+    }
+
+    inline void worker_pool::wait() {
+        unique_lock<mutex> lock(_lock);
+        _idle.wait(lock, [this]() { return _unfinished.load() == 0; });
+
+        if (_error != nullptr) {
+            auto error = _error;
+            _error = nullptr;
+            rethrow_exception(error);
+        }
+    }
+
+    inline bool worker_pool::_pop(size_t index, task& t) {
+        {
+            auto& own = *_workers[index];
+            lock_guard<mutex> lock(own.lock);
+            if (!own.tasks.empty()) {
+                t = move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (size_t i = 1; i < _workers.size(); ++i) {
+            auto& victim = *_workers[(index + i) % _workers.size()];
+            lock_guard<mutex> lock(victim.lock);
+            if (!victim.tasks.empty()) {
+                t = move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    inline void worker_pool::_run(size_t index) {
+        current_pool() = this;
+        current_index() = index;
+
+        for (;;) {
+            task t;
+            if (_pop(index, t)) {
+                _queued.fetch_sub(1);
+                try {
+                    t();
+                }
+                catch (...) {
+                    lock_guard<mutex> lock(_lock);
+                    if (_error == nullptr)
+                        _error = current_exception();
+                }
+                t.reset();
+
+                if (_unfinished.fetch_sub(1) == 1) {
+                    lock_guard<mutex> lock(_lock);
+                    _idle.notify_all();
+                }
+                continue;
+            }
+
+            unique_lock<mutex> lock(_lock);
+            _wake.wait(lock, [this]() { return _stop || _queued.load() != 0; });
+            if (_stop && _queued.load() == 0)
+                return;
+        }
+    }
+
+    template<typename event_type>
+    class event_queue {
+
+    friend coalescing_queue<event_type>;
+
+    private:
+        // Enables the overloads which look events up by a key of another type.
+        template<typename K>
+        using lookup_key = typename enable_if<_eventus_util::is_lookup_key<event_type, K>::value>::type;
+
+        typedef _eventus_util::event_map<event_type, handlers> event_map;
+
+    public:
+        /*! @brief Creates an `event_queue` instance.
+         *
+         * Events are kept in a hash table, unless the event type has an @ref event_key_bound, in which case they are
+         * kept in an array indexed by the key.
+         *
+         * @tparam event_type The type used to delineate events.
+         * @attention When targeting c++11, enums and scoped enums must derive from a type that can be converted to
+         * `size_t`. When using MSVC and targeting a higher standard, use `/Zc:__cplusplus` to turn on default c++14
+         * behavior.
+         */
+        event_queue() : event_queue(*default_resource()) {}
+
+        /*! @brief Creates an `event_queue` instance which runs handlers on pool for @ref fire_async.
+         *
+         * @param pool The workers to run handlers on. It must outlive the `event_queue`.
+         */
+        explicit event_queue(worker_pool& pool) : event_queue(pool, *default_resource()) {}
+
+        /*! @brief Creates an `event_queue` instance which allocates its storage from resource.
+         *
+         * The events, their handlers (including handlers too large to be stored inline) and the queued events are
+         * all allocated from resource, so a `std::pmr::monotonic_buffer_resource` can hold a whole queue and free it
+         * at once. Event keys which allocate themselves, such as long `std::string`s, still use their own allocator.
+         *
+         * @param resource The resource to allocate from. It must outlive the `event_queue`.
+         */
+        explicit event_queue(memory_resource& resource) :
+            events(resource), _deferred(resource), _spare(resource), _resource{&resource} {}
+
+        /*! @brief Creates an `event_queue` instance which runs handlers on pool for @ref fire_async, and allocates its
+         * storage from resource.
+         */
+        event_queue(worker_pool& pool, memory_resource& resource) :
+            events(resource), _deferred(resource), _spare(resource), _pool{&pool}, _resource{&resource} {}
+
+        /*! @brief Adds an event handler which listens for the event and has an input parameter of type T.
+         *
+         *  The handler can be any callable object (lambda, function pointer, @ref handler, etc.). Handlers no larger
+         *  than @ref EVENTUS_DELEGATE_SIZE are stored inline, without a separate heap allocation.
+         *
+         *  T may be a const reference (e.g. `const point&`), in which case the handler receives a reference to the
+         *  fired parameter instead of a copy. Handlers taking `point` and `const point&` listen to the same event.
+         *
+         *  Handlers with a higher priority are called first, and handlers with the same priority are called in the
+         *  order they were added. The order is kept as handlers are added, so firing doesn't sort anything.
+         *
+         *  A handler may return `bool`: returning true consumes the event, and the handlers after it are not called.
+         *  Results of any other type are ignored.
+         *
+         *  @throws std::invalid_argument A previous call to @ref add_handler for the same event had a different number
+         *  of parameters.
+         *  @throws std::bad_cast A previous call to @ref add_handler for the same event used different argument types.
+         *  @throws std::out_of_range The event type has an @ref event_key_bound, and the event is not below it.
+         */
+        template<typename T, typename F>
+        handler_info<event_type, payload_t<T>> add_handler(event_type&& event, F&& event_handler,
+                                                           int priority = 0);
+
+        /*! @brief Adds an event handler which listens for the event and has no input parameter.
+         *
+         *  @throws std::invalid_argument A previous call to @ref add_handler for the same event had a different number
+         *  of parameters.
+         *  @throws std::bad_cast A previous call to @ref add_handler for the same event used different argument types.
+         *  @throws std::out_of_range The event type has an @ref event_key_bound, and the event is not below it.
+         */
+        template<typename F>
+        handler_info<event_type, void> add_handler(event_type&& event, F&& event_handler, int priority = 0);
+
+        /*! @brief Adds an event handler which listens for the event and has several input parameters, e.g.
+         *  `add_handler<int, double, const order&>(event, handler)`.
+         *
+         *  Each parameter type may be a const reference, like the parameter of @ref add_handler. Handlers of events
+         *  with different parameters are kept apart just like handlers with different parameter types.
+         *
+         *  @throws std::invalid_argument A previous call to @ref add_handler for the same event had a different number
+         *  of parameters.
+         *  @throws std::bad_cast A previous call to @ref add_handler for the same event used different argument types.
+         *  @throws std::out_of_range The event type has an @ref event_key_bound, and the event is not below it.
+         */
+        template<typename T, typename U, typename... Ts, typename F>
+        handler_info<event_type, arguments_t<T, U, Ts...>> add_handler(event_type&& event, F&& event_handler,
+                                                                       int priority = 0);
+
+        /*! @brief Adds an event handler like @ref add_handler, looking the event up by a key of another type, such as a
+         *  string literal or `std::string_view` for an `event_queue<std::string>`.
+         *
+         *  An event_type is only constructed from the key if the event has no handlers yet.
+         */
+        template<typename T, typename K, typename F, typename = lookup_key<K>>
+        handler_info<event_type, payload_t<T>> add_handler(const K& event, F&& event_handler, int priority = 0);
+
+        /// Adds an event handler with no input parameter, looking the event up by a key of another type.
+        template<typename F, typename K, typename = lookup_key<K>>
+        handler_info<event_type, void> add_handler(const K& event, F&& event_handler, int priority = 0);
+
+        /// Adds an event handler with several input parameters, looking the event up by a key of another type.
+        template<typename T, typename U, typename... Ts, typename K, typename F>
+        typename enable_if<_eventus_util::is_lookup_key<event_type, K>::value,
+                           handler_info<event_type, arguments_t<T, U, Ts...>>>::type
+        add_handler(const K& event, F&& event_handler, int priority = 0);
+
+        /*! @brief Removes an event handler.
+         *
+         *  @throws handler_info::handler_removed The event handler has already been removed.
+         */
+        template<typename T> void remove_handler(handler_info<event_type, T>& info);
+
+        /*! @brief Fires an event of the specified EventType, passing along the parameter of type T.
+         *
+         *  The parameter is taken by reference and is not copied, except by handlers which take it by value. T is the
+         *  parameter's type unless it is given, as in `fire<int>(event, c)` to fire a char as an int.
+         *
+         *  Handlers may add and remove handlers and fire events, including the event being fired, without the
+         *  handlers being copied. A handler added during a fire isn't called by it, but is called by fires which start
+         *  after it was added, including nested ones; it takes its place by priority once the outermost fire of the
+         *  event returns. A handler removed during a fire isn't called again, even by fires already running, and is
+         *  destroyed once the outermost fire returns.
+         *
+         *  Firing an event never allocates, unless its handlers do or handlers are added during the fire. Firing does
+         *  not construct an event_type for keys which are looked up as another type, such as string literals.
+         *
+         *  @throws std::invalid_argument A previous call to @ref add_handler for the same event had a different number
+         *  of parameters.
+         *  @throws std::bad_cast A previous call to @ref add_handler for the same event used different argument types.
+         */
+        template<typename T = _eventus_util::deduced, typename A> void fire(event_type&& event, A&& parameter);
+
+        /*! @brief Fires an event of the specified EventType with no parameter.
+         *
+         *  @throws std::invalid_argument A previous call to @ref add_handler for the same event had a different number
+         *  of parameters.
+         *  @throws std::bad_cast A previous call to @ref add_handler for the same event used different argument types.
+         */
+        void fire(event_type&& event);
+
+        /*! @brief Fires an event of the specified EventType, passing along each of the parameters, e.g.
+         *  `fire(event, 1, 2.0, o)` for handlers added with `add_handler<int, double, const order&>`.
+         *
+         *  The parameters are passed to the handlers by reference, the same way as the parameter of @ref fire. Their
+         *  types must match the handlers' after decaying, as with a single parameter.
+         *
+         *  @throws std::invalid_argument A previous call to @ref add_handler for the same event had a different number
+         *  of parameters.
+         *  @throws std::bad_cast A previous call to @ref add_handler for the same event used different argument types.
+         */
+        template<typename T, typename U, typename... Ts>
+        void fire(event_type&& event, T&& first, U&& second, Ts&&... rest);
+
+        /*! @brief Fires an event like @ref fire, looking it up by a key of another type, such as a string literal or
+         *  `std::string_view` for an `event_queue<std::string>`, without constructing an event_type.
+         *
+         *  @throws std::invalid_argument A previous call to @ref add_handler for the same event had a different number
+         *  of parameters.
+         *  @throws std::bad_cast A previous call to @ref add_handler for the same event used different argument types.
+         */
+        template<typename T = _eventus_util::deduced, typename K, typename A, typename = lookup_key<K>>
+        void fire(const K& event, A&& parameter);
+
+        /// Fires an event with no parameter, looking it up by a key of another type.
+        template<typename K, typename = lookup_key<K>> void fire(const K& event);
+
+        /// Fires an event with several parameters, looking it up by a key of another type.
+        template<typename K, typename T, typename U, typename... Ts>
+        typename enable_if<_eventus_util::is_lookup_key<event_type, K>::value>::type
+        fire(const K& event, T&& first, U&& second, Ts&&... rest);
+
+        /*! @brief Fires an event of the specified EventType on the @ref worker_pool given to the constructor, passing
+         *  along the parameter of type T, and returns without waiting for the handlers.
+         *
+         *  Each handler is run as a separate task, so the handlers of an event may run at the same time as each
+         *  other, and as handlers of other events. They share one copy of the parameter. The handlers must not use
+         *  the `event_queue`, which is not thread safe; adding and removing handlers on the owning thread is safe.
+         *  Handlers removed after this call may still be run by it. Every handler is run, whatever the others return.
+         *  Use `worker_pool::wait` to wait for the handlers to finish, which must happen before the `event_queue` is
+         *  destroyed.
+         *
+         *  Without a `worker_pool`, this is the same as @ref fire.
+         *
+         *  @throws std::invalid_argument A previous call to @ref add_handler for the same event had a different number
+         *  of parameters.
+         *  @throws std::bad_cast A previous call to @ref add_handler for the same event used different argument types.
+         */
+        template<typename T = _eventus_util::deduced, typename A> void fire_async(event_type&& event, A&& parameter);
+
+        /*! @brief Fires an event of the specified EventType with no parameter on the @ref worker_pool. See
+         *  @ref fire_async.
+         *
+         *  @throws std::invalid_argument A previous call to @ref add_handler for the same event had a different number
+         *  of parameters.
+         *  @throws std::bad_cast A previous call to @ref add_handler for the same event used different argument types.
+         */
+        void fire_async(event_type&& event);
+
+        /*! @brief Resolves an event with an input parameter of type T into an @ref event_channel.
+         *
+         *  The channel fires the event without hashing the event or checking the parameter type again. It stays valid
+         *  for the lifetime of the `event_queue`, and handlers added to or removed from the event afterwards are
+         *  seen by the channel.
+         *
+         *  @throws std::invalid_argument A previous call to @ref add_handler for the same event had a different number
+         *  of parameters.
+         *  @throws std::bad_cast A previous call to @ref add_handler for the same event used different argument types.
+         */
+        template<typename T> event_channel<event_type, payload_t<T>> channel(event_type&& event);
+
+        /*! @brief Resolves an event with no input parameter into an @ref event_channel.
+         *
+         *  @throws std::invalid_argument A previous call to @ref add_handler for the same event had a different number
+         *  of parameters.
+         *  @throws std::bad_cast A previous call to @ref add_handler for the same event used different argument types.
+         */
+        event_channel<event_type, void> channel(event_type&& event);
+
+        /*! @brief Resolves an event with several input parameters into an @ref event_channel.
+         *
+         *  @throws std::invalid_argument A previous call to @ref add_handler for the same event had a different number
+         *  of parameters.
+         *  @throws std::bad_cast A previous call to @ref add_handler for the same event used different argument types.
+         */
+        template<typename T, typename U, typename... Ts>
+        event_channel<event_type, arguments_t<T, U, Ts...>> channel(event_type&& event);
+
+        /*! @brief Queues an event of the specified EventType, to be fired with the parameter of type T by a later call
+         *  to @ref dispatch or @ref drain.
+         *
+         *  The parameter is moved or copied into the queue. Mismatched types are reported when the event is
+         *  dispatched, not when it is queued.
+         */
+        template<typename T = _eventus_util::deduced, typename A> void enqueue(event_type&& event, A&& parameter);
+
+        /// Queues an event of the specified EventType with no parameter. See @ref enqueue.
+        void enqueue(event_type&& event);
+
+        /// Queues an event of the specified EventType with several parameters, which are each moved or copied into
+        /// the queue. See @ref enqueue.
+        template<typename T, typename U, typename... Ts>
+        void enqueue(event_type&& event, T&& first, U&& second, Ts&&... rest);
+
+        /*! @brief Fires every queued event in the order it was queued, and returns the number of events fired.
+         *
+         *  Events queued by handlers while dispatching are left for the next call. Consecutive events with equal keys
+         *  are only looked up once.
+         *
+         *  @throws std::invalid_argument The number of parameters of a queued event doesn't match its handlers. The
+         *  events after it stay queued.
+         *  @throws std::bad_cast The parameter type of a queued event doesn't match its handlers. The events after it
+         *  stay queued.
+         */
+        size_t dispatch();
+
+        /// Fires at most max queued events, like @ref dispatch. The rest stay queued.
+        size_t drain(size_t max);
+
+        /// Gets the number of queued events.
+        size_t queued() const { return _deferred.size(); }
+
+#ifdef EVENTUS_METRICS
+        /*! @brief Gets the counters of every event which has had handlers, and of each of its handlers.
+         *
+         *  Only defined with @ref EVENTUS_METRICS. Fires, channel fires and dispatched events are all counted, and
+         *  each handler call they make is timed. Events which have never had handlers aren't counted, and neither are
+         *  the handlers run by @ref fire_async.
+         */
+        std::vector<event_metrics<event_type>> metrics();
+
+        /*! @brief Gets how long each call to an event handler took. Only defined with @ref EVENTUS_METRICS.
+         *
+         *  @throws handler_info::handler_removed The handler has been removed.
+         */
+        template<typename T> latency_histogram metrics(const handler_info<event_type, T>& handler);
+
+        /// Sets every counter back to zero. Only defined with @ref EVENTUS_METRICS.
+        void reset_metrics();
+#endif
+
+    private:
+        template<typename T, typename K>
+        void _fire(const K& event, bool(*d)(const delegate_t<T>&,const T*), const T* param);
+        template<typename T, typename K>
+        typename event_map::value_type& _find_or_insert(const K& event);
+        template<typename... Ts, typename K>
+        void _fire_arguments(const K& event, const Ts&... parameters);
+        template<typename T>
+        static void _dispatch_queued(handlers& h, const void* payload);
+        template<typename... Ts>
+        static void _dispatch_queued_arguments(handlers& h, const void* payload);
+        template<typename T>
+        void _fire_async(const event_type& event, const shared_ptr<const T>& payload);
+
+        event_map events;
+        _eventus_util::event_buffer<event_type> _deferred;
+        // The payload block of the last batch drained, which the next drain queues into
+        _eventus_util::event_buffer<event_type> _spare;
+        worker_pool* _pool = nullptr;
+        memory_resource* _resource;
+    };
+
+    template<typename event_type>
+    template<typename T, typename F>
+    handler_info<event_type, payload_t<T>> event_queue<event_type>::add_handler(event_type&& event, F&& event_handler,
+                                                                                int priority) {
+        typedef payload_t<T> P;
+        auto& entry = _find_or_insert<P>(event);
+        auto& ref = entry.second.template get<P>().add(forward<F>(event_handler), priority);
+        return handler_info<event_type, P>(entry.first, ref, ref.generation.load(memory_order_relaxed));
+    }
+
+    template<typename event_type>
+    template<typename F>
+    handler_info<event_type, void> event_queue<event_type>::add_handler(event_type&& event, F&& event_handler,
+                                                                        int priority) {
+        return add_handler<void>(forward<event_type>(event), forward<F>(event_handler), priority);
+    }
+
+    template<typename event_type>
+    template<typename T, typename U, typename... Ts, typename F>
+    handler_info<event_type, arguments_t<T, U, Ts...>> event_queue<event_type>::add_handler(event_type&& event,
+                                                                                          F&& event_handler,
+                                                                                          int priority) {
+        return add_handler<arguments_t<T, U, Ts...>>(forward<event_type>(event), forward<F>(event_handler),
+                                                     priority);
+    }
+
+    template<typename event_type>
+    template<typename T, typename K, typename F, typename>
+    handler_info<event_type, payload_t<T>> event_queue<event_type>::add_handler(const K& event, F&& event_handler,
+                                                                                int priority) {
+        typedef payload_t<T> P;
+        auto& entry = _find_or_insert<P>(event);
+        auto& ref = entry.second.template get<P>().add(forward<F>(event_handler), priority);
+        return handler_info<event_type, P>(entry.first, ref, ref.generation.load(memory_order_relaxed));
+    }
+
+    template<typename event_type>
+    template<typename F, typename K, typename>
+    handler_info<event_type, void> event_queue<event_type>::add_handler(const K& event, F&& event_handler,
+                                                                        int priority) {
+        return add_handler<void>(event, forward<F>(event_handler), priority);
+    }
+
+    template<typename event_type>
+    template<typename T, typename U, typename... Ts, typename K, typename F>
+    typename enable_if<_eventus_util::is_lookup_key<event_type, K>::value,
+                       handler_info<event_type, arguments_t<T, U, Ts...>>>::type
+    event_queue<event_type>::add_handler(const K& event, F&& event_handler, int priority) {
+        return add_handler<arguments_t<T, U, Ts...>>(event, forward<F>(event_handler), priority);
+    }
+
+    template<typename event_type>
+    template<typename T>
+    void event_queue<event_type>::remove_handler(handler_info<event_type, T>& info) {
+        info.check();
+        events.at(info.event()).template get<T>().remove(*info._ref);
+    }
+
+    template<typename event_type>
+    template<typename T, typename A>
+    void event_queue<event_type>::fire(event_type&& event, A&& parameter) {
+        typedef fired_t<T, A> P;
+        // Binds directly to the parameter unless it has to be converted (e.g. a string literal to const char*)
+        const P& payload = parameter;
+        _fire<P>(forward<event_type>(event),
+                 [](const delegate_t<P>& h, const P* p) { return h(*p); },
+                 &payload);
+    }
+
+    template<typename event_type>
+    void event_queue<event_type>::fire(event_type&& event) {
+        _fire<void>(forward<event_type>(event),
+                    [](const delegate_t<void>& h, const void*) { return h(); },
+                    nullptr);
+    }
+
+    template<typename event_type>
+    template<typename T, typename U, typename... Ts>
+    void event_queue<event_type>::fire(event_type&& event, T&& first, U&& second, Ts&&... rest) {
+        _fire_arguments<payload_t<T>, payload_t<U>, payload_t<Ts>...>(event, first, second, rest...);
+    }
+
+    template<typename event_type>
+    template<typename T, typename K, typename A, typename>
+    void event_queue<event_type>::fire(const K& event, A&& parameter) {
+        typedef fired_t<T, A> P;
+        const P& payload = parameter;
+        _fire<P>(event, [](const delegate_t<P>& h, const P* p) { return h(*p); }, &payload);
+    }
+
+    template<typename event_type>
+    template<typename K, typename>
+    void event_queue<event_type>::fire(const K& event) {
+        _fire<void>(event, [](const delegate_t<void>& h, const void*) { return h(); }, nullptr);
+    }
+
+    template<typename event_type>
+    template<typename K, typename T, typename U, typename... Ts>
+    typename enable_if<_eventus_util::is_lookup_key<event_type, K>::value>::type
+    event_queue<event_type>::fire(const K& event, T&& first, U&& second, Ts&&... rest) {
+        _fire_arguments<payload_t<T>, payload_t<U>, payload_t<Ts>...>(event, first, second, rest...);
+    }
+
+    template<typename event_type>
+    template<typename... Ts, typename K>
+    void event_queue<event_type>::_fire_arguments(const K& event, const Ts&... parameters) {
+        // The parameters bind directly to the fired arguments, unless they had to be converted (e.g. a string literal
+        // to const char*), in which case the converted values last until fire returns
+        const arguments<Ts...> payload(parameters...);
+        _fire<arguments<Ts...>>(event, &_eventus_util::invoke_ts<arguments<Ts...>>::invoke, &payload);
+    }
+
+    template<typename event_type>
+    template<typename T>
+    event_channel<event_type, payload_t<T>> event_queue<event_type>::channel(event_type&& event) {
+        typedef payload_t<T> P;
+        return event_channel<event_type, P>(_find_or_insert<P>(event).second.template get<P>());
+    }
+
+    template<typename event_type>
+    event_channel<event_type, void> event_queue<event_type>::channel(event_type&& event) {
+        return channel<void>(forward<event_type>(event));
+    }
+
+    template<typename event_type>
+    template<typename T, typename U, typename... Ts>
+    event_channel<event_type, arguments_t<T, U, Ts...>> event_queue<event_type>::channel(event_type&& event) {
+        return channel<arguments_t<T, U, Ts...>>(forward<event_type>(event));
+    }
+
+    template<typename event_type, typename T>
+    void event_channel<event_type, T>::fire(const T& parameter) const {
+        _eventus_util::dispatch<T>(*_table, [](const delegate_t<T>& h, const T* p) { return h(*p); }, &parameter);
+    }
+
+    template<typename event_type>
+    void event_channel<event_type, void>::fire() const {
+        _eventus_util::dispatch<void>(*_table, [](const delegate_t<void>& h, const void*) { return h(); }, nullptr);
+    }
+
+    template<typename event_type, typename... Ts>
+    void event_channel<event_type, arguments<Ts...>>::fire(const Ts&... parameters) const {
+        const arguments<Ts...> payload(parameters...);
+        _eventus_util::dispatch<arguments<Ts...>>(*_table, &_eventus_util::invoke_ts<arguments<Ts...>>::invoke,
+                                                  &payload);
+    }
+
+    template<typename event_type>
+    template<typename T, typename A>
+    void event_queue<event_type>::fire_async(event_type&& event, A&& parameter) {
+        typedef fired_t<T, A> P;
+        if (_pool == nullptr) {
+            fire<P>(forward<event_type>(event), forward<A>(parameter));
+            return;
+        }
+        _fire_async<P>(event, make_shared<const P>(forward<A>(parameter)));
+    }
+
+    template<typename event_type>
+    void event_queue<event_type>::fire_async(event_type&& event) {
+        if (_pool == nullptr) {
+            fire(forward<event_type>(event));
+            return;
+        }
+        _fire_async<void>(event, nullptr);
+    }
+
+    template<typename event_type>
+    template<typename T>
+    void event_queue<event_type>::_fire_async(const event_type& event, const shared_ptr<const T>& payload) {
+        auto found = events.find(event);
+        if (found == events.end())
+            return;
 
-namespace eventus {
-    /// Receives and dispatches events
-    template<typename event_type> class event_queue;
+        auto& table = found->second.template get<T>();
+        if (table.idle())
+            table.settle();
 
-    /// A handle to an event handler object
-    template<typename event_type, typename T> class handler_info;
-}
+        for (const auto& slot : table.slots) {
+            if (slot.live)
+                _pool->submit(_eventus_util::async_call<T>(table, slot.fn, payload));
+        }
+        // Pending handlers are kept in a deque, so the references to them stay valid as more are added
+        for (const auto& slot : table.pending) {
+            if (slot.live)
+                _pool->submit(_eventus_util::async_call<T>(table, slot.fn, payload));
+        }
+    }
 
-namespace _eventus_util {
-    using namespace std;
+    template<typename event_type>
+    template<typename T, typename A>
+    void event_queue<event_type>::enqueue(event_type&& event, A&& parameter) {
+        typedef fired_t<T, A> P;
+        _deferred.template push<P>(forward<event_type>(event), &_dispatch_queued<P>, forward<A>(parameter));
+    }
 
-    struct any_t {
-        struct basetype {
-            const type_info* typeinfo;
-            basetype(const type_info* ti) : typeinfo{ti} {}
-        };
-        template<typename T> struct supertype : public basetype {
-            T value;
-            supertype(T&& val) : value{forward<T>(val)}, basetype(&typeid(value)) {}
-        };
-        template<typename T> static any_t create(T&& value);
-        template<typename T> static T& cast(any_t& c);
-        unique_ptr<basetype> ptr;
-        any_t() = default;
-        any_t(unique_ptr<basetype>&& p) : ptr{move(p)} {}
-    };
+    template<typename event_type>
+    void event_queue<event_type>::enqueue(event_type&& event) {
+        _deferred.template push<void>(forward<event_type>(event), &_dispatch_queued<void>);
+    }
 
-    template<typename T>
-    any_t any_t::create(T&& value) {
-        return any_t(unique_ptr<basetype>(new supertype<T>(forward<T>(value))));
+    template<typename event_type>
+    template<typename T, typename U, typename... Ts>
+    void event_queue<event_type>::enqueue(event_type&& event, T&& first, U&& second, Ts&&... rest) {
+        typedef tuple<payload_t<T>, payload_t<U>, payload_t<Ts>...> P;
+        _deferred.template push<P>(forward<event_type>(event),
+                                   &_dispatch_queued_arguments<payload_t<T>, payload_t<U>, payload_t<Ts>...>,
+                                   forward<T>(first), forward<U>(second), forward<Ts>(rest)...);
     }
 
-    template<typename T>
-    T& any_t::cast(any_t& c) {
-        if (&typeid(T) != c.ptr->typeinfo)
-            throw bad_cast();
-        return static_cast<supertype<T>*>(c.ptr.get())->value;
+    template<typename event_type>
+    size_t event_queue<event_type>::dispatch() {
+        return drain(_deferred.size());
     }
 
-    template<typename T, typename ENABLE = void> struct handler_ts { typedef function<void(T)> type; };
-    template<typename T> struct handler_ts<T, typename enable_if<is_void<T>::value>::type> {
-        typedef function<void()> type;
-    };
-    template<typename T> using handler_t = typename handler_ts<T>::type;
+    template<typename event_type>
+    size_t event_queue<event_type>::drain(size_t max) {
+        // Handlers enqueue into the spare block, so a steady stream of events doesn't allocate
+        auto batch = move(_deferred);
+        _deferred = move(_spare);
+        size_t consumed = 0;
+        _eventus_util::drain_guard<event_type> guard(batch, _deferred, _spare, consumed);
 
+        handlers* last_handlers = nullptr;
+        const event_type* last_event = nullptr;
+        while (consumed < batch.size() && consumed < max) {
+            auto& r = batch.at(consumed);
+            auto payload = batch.payload(consumed);
+            ++consumed;
+
+            // Misses are remembered too: no handler runs between two records with equal keys which have none
+            if (last_event == nullptr || !(r.event == *last_event)) {
+                auto found = events.find(r.event);
+                last_handlers = found == events.end() ? nullptr : &found->second;
+                last_event = &r.event;
+            }
+            if (last_handlers != nullptr)
+                r.dispatch(*last_handlers, payload);
+        }
+        return consumed;
+    }
+
+    template<typename event_type>
     template<typename T>
-    constexpr typename enable_if<!is_void<T>::value, int>::type get_num_params() { return 1; }
-    template<typename T>
-    constexpr typename enable_if<is_void<T>::value, int>::type get_num_params() { return 0; }
-    template<typename T, typename S, typename...Ts>
-    constexpr int get_num_params() { return sizeof...(Ts) + 2; }
+    void event_queue<event_type>::_dispatch_queued(handlers& h, const void* payload) {
+        _eventus_util::dispatch<T>(h.template get<T>(), &_eventus_util::invoke_ts<T>::invoke,
+                                   static_cast<const T*>(payload));
+    }
 
-    class handlers : private any_t {
-    private:
-        handlers(any_t&& a, int p) : any_t(move(a)), NUM_PARAMS{p} {};
+    template<typename event_type>
+    template<typename... Ts>
+    void event_queue<event_type>::_dispatch_queued_arguments(handlers& h, const void* payload) {
+        typedef arguments<Ts...> P;
+        const P parameters(*static_cast<const tuple<Ts...>*>(payload));
+        _eventus_util::dispatch<P>(h.template get<P>(), &_eventus_util::invoke_ts<P>::invoke, &parameters);
+    }
 
-    public:
-        const int NUM_PARAMS;
-        template<typename T> static handlers create();
-        template<typename T> static handlers create(unique_ptr<handler_t<T>>&& h);
-        template<typename T> vector<unique_ptr<handler_t<T>>>& get();
-    };
+    template<typename event_type>
+    template<typename T, typename K>
+    void event_queue<event_type>::_fire(const K& event, bool(*d)(const delegate_t<T>&,const T*), const T* param) {
+        auto found = events.find(event);
+        if (found == events.end())
+            return;
 
-    template<typename T>
-    handlers handlers::create() {
-        return handlers(any_t::create(vector<unique_ptr<handler_t<T>>>(0)), get_num_params<T>());
+        _eventus_util::dispatch<T>(found->second.template get<T>(), d, param);
     }
 
-    template<typename T>
-    handlers handlers::create(unique_ptr<handler_t<T>>&& h) {
-        auto result = handlers(any_t::create(vector<unique_ptr<handler_t<T>>>(1)), get_num_params<T>());
-        result.get<T>().emplace_back(move(h));
+    template<typename event_type>
+    template<typename T, typename K>
+    typename event_queue<event_type>::event_map::value_type& event_queue<event_type>::_find_or_insert(const K& event) {
+        auto found = events.find(event);
+        if (found != events.end())
+            return *found;
+        auto& entry = *events.emplace(event, handlers::create<T>(*_resource)).first;
+#ifdef EVENTUS_TRACE
+        entry.second.template get<T>().trace_name =
+            _eventus_util::trace_log::instance().intern(event_name<event_type>::get(entry.first));
+#endif
+        return entry;
+    }
+
+#ifdef EVENTUS_METRICS
+    template<typename event_type>
+    std::vector<event_metrics<event_type>> event_queue<event_type>::metrics() {
+        auto result = std::vector<event_metrics<event_type>>();
+        events.for_each([&result](typename event_map::value_type& entry) {
+            result.push_back({ entry.first, 0, 0, {} });
+            auto& m = result.back();
+            entry.second.collect(m.fires, m.handlers_invoked, m.handlers);
+        });
         return result;
     }
 
+    template<typename event_type>
     template<typename T>
-    vector<unique_ptr<handler_t<T>>>& handlers::get() {
-        try {
-            return any_t::cast<vector<unique_ptr<handler_t<T>>>>(*this);
-        }
-        catch (bad_cast ex) {
-            if (get_num_params<T>() == NUM_PARAMS)
-                throw ex;
-            throw invalid_argument("Previous operations on this event type used a different number of arguments");
-        }
+    latency_histogram event_queue<event_type>::metrics(const handler_info<event_type, T>& handler) {
+        handler.check();
+        auto& table = events.at(handler._event).template get<T>();
+        auto& ref = *handler._ref;
+        return ref.pending ? table.pending[ref.position].latency : table.slots[ref.position].latency;
+    }
+
+    template<typename event_type>
+    void event_queue<event_type>::reset_metrics() {
+        events.for_each([](typename event_map::value_type& entry) { entry.second.reset_metrics(); });
     }
+#endif
 }
 
+
 namespace eventus {
-    using namespace std;
-    using _eventus_util::handlers;
+    template<typename... Events>
+    class static_event_queue {
+    public:
+        /*! @brief Creates a `static_event_queue` instance.
+         *
+         *  Each event is a type which names its parameter type as `payload`, or `void` for no parameter:
+         *  @code
+         *  struct moved { using payload = point; };
+         *  struct closed { using payload = void; };
+         *  auto eq = eventus::static_event_queue<moved, closed>();
+         *  @endcode
+         *  The handlers of each event are stored in a typed table, so firing an event doesn't look anything up, and
+         *  mismatched types are compile errors rather than exceptions.
+         *
+         *  @tparam Events The events, which must be default constructible.
+         */
+        static_event_queue() = default;
 
-    /// Alias for `std::function<void(T)>` or `std::function<void()>`.
-    template<typename T> using handler = _eventus_util::handler_t<T>;
+        /*! @brief Creates a `static_event_queue` instance which allocates its handlers from resource, which must
+         *  outlive it.
+         */
+        explicit static_event_queue(memory_resource& resource) :
+            _tables(handler_table<_eventus_util::event_payload_t<Events>>(resource)...) {}
 
-    template<typename event_type, typename T>
-    class handler_info {
+        /*! @brief Moves a `static_event_queue` instance, along with its handlers.
+         *
+         *  The handler_info of its handlers refer to the moved-to queue afterwards, but its channels are invalidated:
+         *  they point into the moved-from queue, so get them again with @ref channel.
+         */
+        static_event_queue(static_event_queue&&) = default;
+        static_event_queue(const static_event_queue&) = delete;
+        static_event_queue& operator=(const static_event_queue&) = delete;
 
-    friend event_queue<event_type>;
+        /// Adds an event handler which listens for the event E. Handlers with a higher priority are called first.
+        template<typename E, typename F>
+        handler_info<E, _eventus_util::event_payload_t<E>> add_handler(F&& event_handler, int priority = 0);
 
-    private:
-        const event_type _event;
-        const handler<T>* _handler;
+        /*! @brief Removes an event handler.
+         *
+         *  @throws handler_info::handler_removed The event handler has already been removed.
+         */
+        template<typename E> void remove_handler(handler_info<E, _eventus_util::event_payload_t<E>>& info);
 
-        const handler<T>* get_handler() const {
-            if (_handler == nullptr)
-                throw handler_removed();
-            return _handler;
+        /// Fires the event E, passing along the parameter.
+        template<typename E, typename T> void fire(T&& parameter);
+
+        /// Fires the event E, which has no parameter.
+        template<typename E> void fire();
+
+        /// Gets a channel which fires the event E.
+        template<typename E> event_channel<E, _eventus_util::event_payload_t<E>> channel();
+
+    private:
+        template<typename E>
+        handler_table<_eventus_util::event_payload_t<E>>& _table() {
+            return get<_eventus_util::index_of<E, Events...>::value>(_tables);
         }
 
-        void clear() { _handler = nullptr; }
+        tuple<handler_table<_eventus_util::event_payload_t<Events>>...> _tables;
+    };
 
-        handler_info(const event_type& event, eventus::handler<T>* event_handler) :
-            _event(event),
-            _handler { event_handler } {}
+    template<typename... Events>
+    template<typename E, typename F>
+    handler_info<E, _eventus_util::event_payload_t<E>> static_event_queue<Events...>::add_handler(F&& event_handler,
+                                                                                                  int priority) {
+#ifdef EVENTUS_TRACE
+        _table<E>().trace_name = _eventus_util::type_name<E>();
+#endif
+        auto& ref = _table<E>().add(forward<F>(event_handler), priority);
+        return handler_info<E, _eventus_util::event_payload_t<E>>(E(), ref, ref.generation.load(memory_order_relaxed));
+    }
 
-    public:
-        /// Thrown when trying to remove an event handler which no longer exists.
-        class handler_removed : exception {};
+    template<typename... Events>
+    template<typename E>
+    void static_event_queue<Events...>::remove_handler(handler_info<E, _eventus_util::event_payload_t<E>>& info) {
+        info.check();
+        _table<E>().remove(*info._ref);
+    }
 
-        /// Gets the event the handler is attached to.
-        const event_type& event() const { return _event; }
+    template<typename... Events>
+    template<typename E, typename T>
+    void static_event_queue<Events...>::fire(T&& parameter) {
+        typedef _eventus_util::event_payload_t<E> P;
+        static_assert(!is_void<P>::value, "The event has no parameter");
+        const P& payload = parameter;
+        _eventus_util::dispatch<P>(_table<E>(), &_eventus_util::invoke_ts<P>::invoke, &payload);
+    }
 
-        /// Tests to see if the event handler still exists.
-        bool removed() const { return _handler != nullptr; }
-    };
+    template<typename... Events>
+    template<typename E>
+    void static_event_queue<Events...>::fire() {
+        static_assert(is_void<_eventus_util::event_payload_t<E>>::value, "The event needs a parameter");
+        _eventus_util::dispatch<void>(_table<E>(), &_eventus_util::invoke_ts<void>::invoke, nullptr);
+    }
 
+    template<typename... Events>
+    template<typename E>
+    event_channel<E, _eventus_util::event_payload_t<E>> static_event_queue<Events...>::channel() {
+        return event_channel<E, _eventus_util::event_payload_t<E>>(_table<E>());
+    }
+}
+
+
+namespace eventus {
     template<typename event_type>
-    class event_queue {
+    class concurrent_event_queue {
     public:
-        /*! @brief Creates an `event_queue` instance.
+        /*! @brief Creates a `concurrent_event_queue` instance.
          *
-         * @tparam event_type The type used to delineate events.
-         * @attention When targeting c++11, enums and scoped enums must derive from a type that can be converted to
-         * `size_t`. When using MSVC and targeting a higher standard, use `/Zc:__cplusplus` to turn on default c++14
-         * behavior.
+         *  Any member may be called from any thread at once. Firing never takes a lock: each event's handlers are
+         *  kept in an immutable snapshot which @ref add_handler and @ref remove_handler replace, and old snapshots are
+         *  only destroyed once no thread can still be firing through them.
+         *
+         *  Handlers are called on the thread that fires the event, possibly by several threads at once. A handler
+         *  added during a fire is not called by it. Once @ref remove_handler returns, fires which start afterwards
+         *  don't call the removed handler, though fires already running may still be calling it.
+         *
+         *  @tparam event_type The type used to delineate events.
          */
-        event_queue() = default;
+        concurrent_event_queue();
+
+        concurrent_event_queue(const concurrent_event_queue&) = delete;
+        concurrent_event_queue& operator=(const concurrent_event_queue&) = delete;
 
         /*! @brief Adds an event handler which listens for the event and has an input parameter of type T.
+         *
+         *  Handlers with a higher priority are called first, and handlers with the same priority are called in the
+         *  order they were added. A handler returning true stops the event, like for @ref event_queue::add_handler.
          *
          *  @throws std::invalid_argument A previous call to @ref add_handler for the same event had a different number
          *  of parameters.
          *  @throws std::bad_cast A previous call to @ref add_handler for the same event used different argument types.
          */
-        template<typename T> handler_info<event_type, T> add_handler(event_type&& event, handler<T> event_handler);
+        template<typename T, typename F>
+        handler_info<event_type, payload_t<T>> add_handler(event_type&& event, F&& event_handler,
+                                                           int priority = 0);
 
         /*! @brief Adds an event handler which listens for the event and has no input parameter.
          *
@@ -172,7 +2981,8 @@ namespace eventus {
          *  of parameters.
          *  @throws std::bad_cast A previous call to @ref add_handler for the same event used different argument types.
          */
-        handler_info<event_type, void> add_handler(event_type&& event, handler<void> event_handler);
+        template<typename F>
+        handler_info<event_type, void> add_handler(event_type&& event, F&& event_handler, int priority = 0);
 
         /*! @brief Removes an event handler.
          *
@@ -186,7 +2996,7 @@ namespace eventus {
          *  of parameters.
          *  @throws std::bad_cast A previous call to @ref add_handler for the same event used different argument types.
          */
-        template<typename T> void fire(event_type&& event, T parameter);
+        template<typename T = _eventus_util::deduced, typename A> void fire(event_type&& event, A&& parameter) const;
 
         /*! @brief Fires an event of the specified EventType with no parameter.
          *
@@ -194,99 +3004,523 @@ namespace eventus {
          *  of parameters.
          *  @throws std::bad_cast A previous call to @ref add_handler for the same event used different argument types.
          */
-        void fire(event_type&& event);
+        void fire(event_type&& event) const;
 
     private:
-#if __cplusplus < 201402L
-        // Workaround for enums and class enums in c++11
-        struct enum_hash {
-            template<typename T> size_t operator()(T key) const { return static_cast<size_t>(key); }
-        };
-        template<typename T>
-        using hasher = typename conditional<is_enum<T>::value, enum_hash, hash<T>>::type;
-#else
-        template<typename T> using hasher = hash<T>;
-#endif
+        typedef _eventus_util::concurrent_entry entry;
+        typedef unordered_map<event_type, entry*, _eventus_util::hasher<event_type>> entry_map;
 
         template<typename T>
-        void _fire(event_type&& event, void(*d)(const handler<T>*,T*), T* param);
+        void _fire(const event_type& event, const T* param) const;
         template<typename T>
-        void _remove_unused(vector<unique_ptr<handler<T>>>& handler_vec);
+        entry& _find_or_insert(const event_type& event);
+        void _publish(entry& e, shared_ptr<void>&& snapshot);
+        void _reclaim();
 
-        unordered_map<event_type, handlers, hasher<event_type>> events;
+        atomic<const entry_map*> _events;
+        shared_ptr<entry_map> _events_owner;
+        vector<unique_ptr<entry>> _entries;
+        vector<shared_ptr<void>> _retired;
+        mutex _write;
+        mutable _eventus_util::read_domain _readers;
     };
 
+    template<typename event_type>
+    concurrent_event_queue<event_type>::concurrent_event_queue() :
+        _events(nullptr),
+        _events_owner{make_shared<entry_map>()} {
+        _events.store(_events_owner.get());
+    }
+
+    template<typename event_type>
+    template<typename T, typename F>
+    handler_info<event_type, payload_t<T>> concurrent_event_queue<event_type>::add_handler(event_type&& event,
+                                                                                          F&& event_handler,
+                                                                                          int priority) {
+        typedef payload_t<T> P;
+        auto handler = make_shared<_eventus_util::shared_handler<P>>(delegate_t<P>(forward<F>(event_handler)),
+                                                                     priority);
+        _eventus_util::slot_ref* ref;
+        size_t generation;
+        {
+            lock_guard<mutex> lock(_write);
+            auto& e = _find_or_insert<P>(event);
+            auto next = make_shared<_eventus_util::handler_snapshot<P>>(
+                *static_cast<const _eventus_util::handler_snapshot<P>*>(e.snapshot.load()));
+            ref = &e.refs.acquire();
+            generation = ref->generation.load(memory_order_relaxed);
+            handler->ref = ref;
+            // Kept in the order they are called, like the slots of a handler_table
+            auto position = next->end();
+            while (position != next->begin() && (*(position - 1))->priority < priority)
+                --position;
+            next->insert(position, handler);
+            _publish(e, move(next));
+        }
+        _reclaim();
+        return handler_info<event_type, P>(event, *ref, generation);
+    }
+
+    template<typename event_type>
+    template<typename F>
+    handler_info<event_type, void> concurrent_event_queue<event_type>::add_handler(event_type&& event,
+                                                                                  F&& event_handler, int priority) {
+        return add_handler<void>(forward<event_type>(event), forward<F>(event_handler), priority);
+    }
+
     template<typename event_type>
     template<typename T>
-    handler_info<event_type, T> event_queue<event_type>::add_handler(event_type&& event, handler<T> event_handler) {
-        if (events.count(event) == 0)
-            events.emplace(event, handlers::create<T>());
+    void concurrent_event_queue<event_type>::remove_handler(handler_info<event_type, T>& info) {
+        {
+            lock_guard<mutex> lock(_write);
+            info.check();
+            auto found = _events_owner->find(info.event());
+            if (found == _events_owner->end())
+                throw out_of_range("event has no handlers");
+
+            auto& e = *found->second;
+            e.template check<T>();
+            auto current = static_cast<const _eventus_util::handler_snapshot<T>*>(e.snapshot.load());
+            auto next = make_shared<_eventus_util::handler_snapshot<T>>();
+            next->reserve(current->size());
+            for (const auto& h : *current) {
+                if (h->ref == info._ref)
+                    h->removed.store(true);
+                else
+                    next->push_back(h);
+            }
 
-        auto ptr_handler = unique_ptr<handler<T>>(new handler<T>(event_handler));
-        auto info = handler_info<event_type, T>(event, ptr_handler.get());
-        events.at(event).template get<T>().emplace_back(move(ptr_handler));
-        return info;
+            _publish(e, move(next));
+            e.refs.release(*info._ref);
+        }
+        _reclaim();
+    }
+
+    template<typename event_type>
+    template<typename T, typename A>
+    void concurrent_event_queue<event_type>::fire(event_type&& event, A&& parameter) const {
+        typedef fired_t<T, A> P;
+        const P& payload = parameter;
+        _fire<P>(event, &payload);
     }
 
     template<typename event_type>
-    handler_info<event_type, void> event_queue<event_type>::add_handler(event_type&& event, handler<void> event_handler) {
-        return add_handler<void>(forward<event_type>(event), event_handler);
+    void concurrent_event_queue<event_type>::fire(event_type&& event) const {
+        _fire<void>(event, nullptr);
     }
 
     template<typename event_type>
     template<typename T>
-    void event_queue<event_type>::remove_handler(handler_info<event_type, T>& info) {
-        auto remove_handler = info.get_handler();
-        auto& handler_vec = events.at(info.event()).template get<T>();
+    void concurrent_event_queue<event_type>::_fire(const event_type& event, const T* param) const {
+        _eventus_util::read_section section(_readers);
 
-        for (auto& h : handler_vec) {
-            if (h.get() != remove_handler)
-                continue;
+        auto events = _events.load(memory_order_acquire);
+        auto found = events->find(event);
+        if (found == events->end())
+            return;
 
-            h = nullptr;
-            info.clear();
-            break;
+        auto& e = *found->second;
+        e.template check<T>();
+        auto snapshot = static_cast<const _eventus_util::handler_snapshot<T>*>(e.snapshot.load(memory_order_acquire));
+        for (const auto& h : *snapshot) {
+            if (!h->removed.load(memory_order_relaxed) && _eventus_util::invoke_ts<T>::invoke(h->fn, param))
+                return;
         }
     }
 
     template<typename event_type>
     template<typename T>
-    void event_queue<event_type>::fire(event_type&& event, T parameter) {
-        _fire<T>(forward<event_type>(event),
-                 [](const handler<T>* h, T* p) { (*h)(*p); },
-                 &parameter);
+    _eventus_util::concurrent_entry& concurrent_event_queue<event_type>::_find_or_insert(const event_type& event) {
+        auto found = _events_owner->find(event);
+        if (found != _events_owner->end()) {
+            found->second->template check<T>();
+            return *found->second;
+        }
+
+        _entries.emplace_back(new entry(_eventus_util::type_id<T>(),
+                                        _eventus_util::get_num_params<T>(),
+                                        make_shared<_eventus_util::handler_snapshot<T>>()));
+        auto next = make_shared<entry_map>(*_events_owner);
+        next->emplace(event, _entries.back().get());
+        _events.store(next.get(), memory_order_release);
+        _retired.push_back(move(_events_owner));
+        _events_owner = move(next);
+        return *_entries.back();
     }
 
     template<typename event_type>
-    void event_queue<event_type>::fire(event_type&& event) {
-        _fire<void>(forward<event_type>(event),
-                    [](const handler<void>* h, void*) { (*h)(); },
-                    nullptr);
+    void concurrent_event_queue<event_type>::_publish(entry& e, shared_ptr<void>&& snapshot) {
+        e.snapshot.store(snapshot.get(), memory_order_release);
+        _retired.push_back(move(e.owner));
+        e.owner = move(snapshot);
     }
 
     template<typename event_type>
-    template<typename T>
-    void event_queue<event_type>::_fire(event_type&& event, void(*d)(const handler<T>*,T*), T* param) {
-        if (events.count(event) != 1)
+    void concurrent_event_queue<event_type>::_reclaim() {
+        // A handler changing handlers can't wait for the fire it is running in, so what it replaced is reclaimed by
+        // a later change.
+        if (_eventus_util::read_domain::depth() != 0)
             return;
 
-        auto has_removal = false;
-        auto& handler_vec = events.at(event).template get<T>();
-        for (const auto& h : handler_vec) {
-            if (h == nullptr)
-                has_removal = true;
-            else
-                (*d)(h.get(), param);
+        vector<shared_ptr<void>> retired;
+        {
+            lock_guard<mutex> lock(_write);
+            retired.swap(_retired);
+        }
+        if (!retired.empty())
+            _readers.synchronize();
+    }
+}
+
+namespace eventus {
+    template<typename event_type, size_t Size = sizeof(event_type) + EVENTUS_DELEGATE_SIZE>
+    class event_ring {
+    public:
+        /*! @brief Creates an `event_ring` which fires events through queue.
+         *
+         *  Any thread may @ref post to the ring at once, without taking a lock. Only the thread which owns the
+         *  `event_queue` may call @ref pump.
+         *
+         *  @param queue The queue whose handlers receive the events. It must outlive the ring.
+         *  @param capacity The number of events the ring holds, rounded up to a power of two.
+         *  @param policy What @ref post does when the ring is full.
+         *  @tparam Size The number of bytes of each slot. Events (key and parameter together) which don't fit are
+         *  allocated on the heap.
+         */
+        event_ring(event_queue<event_type>& queue, size_t capacity, overflow_policy policy = overflow_policy::block);
+
+        event_ring(const event_ring&) = delete;
+        event_ring& operator=(const event_ring&) = delete;
+
+        /*! @brief Posts an event of the specified EventType, to be fired with the parameter of type T by @ref pump.
+         *
+         *  @returns false if the ring was full and the event was dropped, otherwise true.
+         */
+        template<typename T = _eventus_util::deduced, typename A> bool post(event_type&& event, A&& parameter);
+
+        /// Posts an event of the specified EventType with no parameter. See @ref post.
+        bool post(event_type&& event);
+
+        /*! @brief Fires at most max posted events, oldest first, and returns the number of events fired.
+         *
+         *  Mismatched types are reported here, as in `event_queue::fire`. The events after the one which threw stay
+         *  in the ring.
+         */
+        size_t pump(size_t max);
+
+        /// Fires the events in the ring, at most one ring's worth. See @ref pump(size_t).
+        size_t pump() { return pump(capacity()); }
+
+        /// Gets the number of events the ring holds.
+        size_t capacity() const { return _mask + 1; }
+
+    private:
+        typedef _eventus_util::delegate<void(event_queue<event_type>&), Size> item;
+
+        // A slot of the ring. The sequence tells producers and the consumer whose turn it is to use the slot, as in
+        // Dmitry Vyukov's bounded MPMC queue.
+        struct cell {
+            atomic<size_t> sequence;
+            item value;
+        };
+
+        bool _post(item&& value);
+        bool _try_push(item& value);
+        bool _try_pop(item& value);
+
+        event_queue<event_type>& _queue;
+        const overflow_policy _policy;
+        const size_t _mask;
+        unique_ptr<cell[]> _cells;
+        char _padding0[128];
+        atomic<size_t> _push_position;
+        char _padding1[128];
+        atomic<size_t> _pop_position;
+    };
+
+    template<typename event_type, size_t Size>
+    event_ring<event_type, Size>::event_ring(event_queue<event_type>& queue, size_t capacity, overflow_policy policy) :
+        _queue(queue),
+        _policy{policy},
+        _mask{_eventus_util::round_up_pow2(capacity < 2 ? 2 : capacity) - 1},
+        _cells{new cell[_mask + 1]},
+        _push_position(0),
+        _pop_position(0) {
+        for (size_t i = 0; i <= _mask; ++i)
+            _cells[i].sequence.store(i, memory_order_relaxed);
+    }
+
+    template<typename event_type, size_t Size>
+    template<typename T, typename A>
+    bool event_ring<event_type, Size>::post(event_type&& event, A&& parameter) {
+        typedef fired_t<T, A> P;
+        struct fire_later {
+            event_type event;
+            P parameter;
+            void operator()(event_queue<event_type>& queue) { queue.fire(move(event), move(parameter)); }
+        };
+        return _post(item(fire_later { forward<event_type>(event), forward<A>(parameter) }));
+    }
+
+    template<typename event_type, size_t Size>
+    bool event_ring<event_type, Size>::post(event_type&& event) {
+        struct fire_later {
+            event_type event;
+            void operator()(event_queue<event_type>& queue) { queue.fire(move(event)); }
+        };
+        return _post(item(fire_later { forward<event_type>(event) }));
+    }
+
+    template<typename event_type, size_t Size>
+    size_t event_ring<event_type, Size>::pump(size_t max) {
+        size_t fired = 0;
+        item value;
+        while (fired < max && _try_pop(value)) {
+            ++fired;
+            auto fire = move(value);
+            fire(_queue);
         }
+        return fired;
+    }
+
+    template<typename event_type, size_t Size>
+    bool event_ring<event_type, Size>::_post(item&& value) {
+        while (!_try_push(value)) {
+            switch (_policy) {
+            case overflow_policy::block:
+                this_thread::yield();
+                break;
+            case overflow_policy::drop_newest:
+                return false;
+            case overflow_policy::drop_oldest: {
+                item oldest;
+                _try_pop(oldest);
+                break;
+            }
+            }
+        }
+        return true;
+    }
+
+    template<typename event_type, size_t Size>
+    bool event_ring<event_type, Size>::_try_push(item& value) {
+        auto position = _push_position.load(memory_order_relaxed);
+        for (;;) {
+            auto& c = _cells[position & _mask];
+            auto sequence = c.sequence.load(memory_order_acquire);
+            auto diff = static_cast<ptrdiff_t>(sequence - position);
+            if (diff == 0) {
+                if (_push_position.compare_exchange_weak(position, position + 1, memory_order_relaxed)) {
+                    c.value = move(value);
+                    c.sequence.store(position + 1, memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                return false;
+            }
+            else {
+                position = _push_position.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    template<typename event_type, size_t Size>
+    bool event_ring<event_type, Size>::_try_pop(item& value) {
+        auto position = _pop_position.load(memory_order_relaxed);
+        for (;;) {
+            auto& c = _cells[position & _mask];
+            auto sequence = c.sequence.load(memory_order_acquire);
+            auto diff = static_cast<ptrdiff_t>(sequence - (position + 1));
+            if (diff == 0) {
+                if (_pop_position.compare_exchange_weak(position, position + 1, memory_order_relaxed)) {
+                    value = move(c.value);
+                    c.sequence.store(position + _mask + 1, memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                return false;
+            }
+            else {
+                position = _pop_position.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    template<typename event_type>
+    class coalescing_queue {
+    public:
+        /*! @brief Creates a `coalescing_queue` which fires events through queue.
+         *
+         *  Posting an event which is already waiting to be fired replaces its parameter, so each @ref dispatch fires
+         *  every posted event once, with the latest parameter. A burst of updates to the same event costs one call to
+         *  each handler, and the queue never grows beyond the number of distinct events.
+         *
+         *  The parameter of each event is stored when the event is first posted and assigned to after that, so
+         *  posting an event again doesn't allocate unless assigning the parameter does, and a `std::string` or
+         *  `std::vector` parameter reuses its capacity. Handlers are given the stored parameter without copying it.
+         *  Storage comes from the queue's memory_resource.
+         *
+         *  @param queue The queue whose handlers receive the events. It must outlive the `coalescing_queue`.
+         */
+        explicit coalescing_queue(event_queue<event_type>& queue);
+
+        coalescing_queue(const coalescing_queue&) = delete;
+        coalescing_queue& operator=(const coalescing_queue&) = delete;
+
+        /*! @brief Posts an event of the specified EventType, to be fired with the parameter of type T by
+         *  @ref dispatch. If the event is already waiting to be fired, its parameter is replaced and the event keeps
+         *  its place.
+         *
+         *  Mismatched types are reported when the event is dispatched, not when it is posted.
+         */
+        template<typename T = _eventus_util::deduced, typename A> void post(event_type&& event, A&& parameter);
+
+        /// Posts an event of the specified EventType with no parameter. See @ref post.
+        void post(event_type&& event);
+
+        /*! @brief Fires each posted event once, with its latest parameter, in the order the events were first posted
+         *  since the last dispatch. Returns the number of events fired, which counts events without handlers: they are
+         *  dropped.
+         *
+         *  Events which handlers post while dispatching are fired by the next call, except events this call has yet
+         *  to fire, which are fired with the new parameter.
+         *
+         *  @throws std::invalid_argument The number of parameters of a posted event doesn't match its handlers. The
+         *  events after it stay posted.
+         *  @throws std::bad_cast The parameter type of a posted event doesn't match its handlers. The events after it
+         *  stay posted.
+         */
+        size_t dispatch();
+
+        /// Gets the number of events waiting to be fired.
+        size_t queued() const { return _order.size(); }
+
+    private:
+        typedef _eventus_util::event_map<event_type, _eventus_util::coalesced<event_type>> slot_map;
+        typedef typename slot_map::value_type entry;
+
+        template<typename T>
+        static void _fire_slot(event_queue<event_type>& queue, const event_type& event,
+                               _eventus_util::coalesced<event_type>& slot);
+        static void _fire_void(event_queue<event_type>& queue, const event_type& event,
+                               _eventus_util::coalesced<event_type>& slot);
+        entry& _find_or_insert(const event_type& event);
+        void _push(entry& e);
+
+        event_queue<event_type>& _queue;
+        slot_map _slots;
+        _eventus_util::resource_vector<entry*> _order;
+        // The order vector of the last dispatch, kept for its capacity
+        _eventus_util::resource_vector<entry*> _spare;
+    };
+
+    template<typename event_type>
+    coalescing_queue<event_type>::coalescing_queue(event_queue<event_type>& queue) :
+        _queue(queue),
+        _slots(*queue._resource),
+        _order(*queue._resource),
+        _spare(*queue._resource) {}
+
+    template<typename event_type>
+    template<typename T, typename A>
+    void coalescing_queue<event_type>::post(event_type&& event, A&& parameter) {
+        typedef fired_t<T, A> P;
+        auto& e = _find_or_insert(event);
+        auto& slot = e.second;
+        if (slot.fire == &_fire_slot<P> && slot.payload.ptr) {
+            _eventus_util::any_t::cast<P>(slot.payload) = forward<A>(parameter);
+        }
+        else {
+            slot.payload = _eventus_util::any_t::create(P(forward<A>(parameter)), *_queue._resource);
+            slot.fire = &_fire_slot<P>;
+        }
+        _push(e);
+    }
 
-        if (has_removal)
-            _remove_unused<T>(handler_vec);
+    template<typename event_type>
+    void coalescing_queue<event_type>::post(event_type&& event) {
+        auto& e = _find_or_insert(event);
+        if (e.second.fire != &_fire_void) {
+            e.second.payload = _eventus_util::any_t();
+            e.second.fire = &_fire_void;
+        }
+        _push(e);
+    }
+
+    template<typename event_type>
+    size_t coalescing_queue<event_type>::dispatch() {
+        // Handlers may post, and even dispatch, while the batch is fired
+        auto batch = move(_order);
+        _order = move(_spare);
+        _order.clear();
+        // Room for the same events again, so posting them doesn't allocate
+        _order.reserve(batch.size());
+
+        size_t fired = 0;
+        try {
+            while (fired < batch.size()) {
+                auto& e = *batch[fired++];
+                e.second.posted = false;
+                e.second.fire(_queue, e.first, e.second);
+            }
+        }
+        catch (...) {
+            // The events which weren't fired go back ahead of the ones posted since
+            _order.insert(_order.begin(), batch.begin() + fired, batch.end());
+            batch.clear();
+            _spare = move(batch);
+            throw;
+        }
+        batch.clear();
+        _spare = move(batch);
+        return fired;
     }
 
     template<typename event_type>
     template<typename T>
-    void event_queue<event_type>::_remove_unused(vector<unique_ptr<handler<T>>>& handler_vec) {
-        remove(handler_vec.begin(), handler_vec.end(), nullptr);
+    void coalescing_queue<event_type>::_fire_slot(event_queue<event_type>& queue, const event_type& event,
+                                                  _eventus_util::coalesced<event_type>& slot) {
+        // Taken out first, so a handler posting the event again, even with another type, doesn't change or destroy
+        // the value the other handlers are given
+        auto taken = move(slot.payload);
+        const T& value = _eventus_util::any_t::cast<T>(taken);
+        // Put back for its storage, unless a handler posted a replacement
+        auto put_back = [&]() {
+            if (slot.fire == &_fire_slot<T> && !slot.payload.ptr)
+                slot.payload = move(taken);
+        };
+        try {
+            queue.template _fire<T>(event, &_eventus_util::invoke_ts<T>::invoke, &value);
+        }
+        catch (...) {
+            put_back();
+            throw;
+        }
+        put_back();
+    }
+
+    template<typename event_type>
+    void coalescing_queue<event_type>::_fire_void(event_queue<event_type>& queue, const event_type& event,
+                                                  _eventus_util::coalesced<event_type>&) {
+        queue.template _fire<void>(event, &_eventus_util::invoke_ts<void>::invoke, nullptr);
+    }
+
+    template<typename event_type>
+    typename coalescing_queue<event_type>::entry&
+    coalescing_queue<event_type>::_find_or_insert(const event_type& event) {
+        auto found = _slots.find(event);
+        if (found != _slots.end())
+            return *found;
+        return *_slots.emplace(event, _eventus_util::coalesced<event_type>()).first;
     }
-}
 
+    template<typename event_type>
+    void coalescing_queue<event_type>::_push(entry& e) {
+        if (e.second.posted)
+            return;
+        e.second.posted = true;
+        _order.push_back(&e);
+    }
+}
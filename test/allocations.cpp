@@ -0,0 +1,216 @@
+#define CATCH_CONFIG_MAIN
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include "catch.hpp"
+#include "../eventus.hpp"
+
+using namespace eventus;
+using namespace std;
+
+// These tests replace the global operator new to count heap allocations, so they are built as their own executable.
+
+namespace {
+    atomic<long> allocations(0);
+}
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, memory_order_relaxed);
+    if (void* p = malloc(size == 0 ? 1 : size))
+        return p;
+    throw bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    free(p);
+}
+
+namespace {
+    // Counts the heap allocations made while running f.
+    template<typename F> long allocations_in(F&& f) {
+        auto before = allocations.load(memory_order_relaxed);
+        f();
+        return allocations.load(memory_order_relaxed) - before;
+    }
+
+    struct tick {
+        double price;
+        int quantity;
+    };
+
+    enum key { MOVED, RESIZED, CLOSED };
+    enum class dense_key : unsigned { MOVED, RESIZED, CLOSED, COUNT };
+
+    struct moved { using payload = tick; };
+    struct closed { using payload = void; };
+}
+
+namespace eventus {
+    template<> struct event_key_bound<dense_key> : integral_constant<size_t, static_cast<size_t>(dense_key::COUNT)> {};
+}
+
+TEST_CASE("firing registered events doesn't allocate", "[allocations]") {
+    auto sum = 0;
+    auto on_tick = [&sum](const tick& t) { sum += t.quantity; };
+
+    SECTION("allocations are counted") {
+        REQUIRE(allocations_in([] { ::operator delete(::operator new(16)); }) == 1);
+    }
+
+    SECTION("with int keys") {
+        auto eq = event_queue<int>();
+        for (auto i = 0; i < 100; ++i)
+            eq.add_handler<const tick&>(int(i), on_tick);
+        eq.fire(7, tick { 1.0, 1 });
+
+        REQUIRE(allocations_in([&] {
+            for (auto i = 0; i < 100; ++i)
+                eq.fire(int(i), tick { 1.0, 1 });
+            eq.fire(1000, tick { 1.0, 1 });
+        }) == 0);
+        REQUIRE(sum == 101);
+    }
+
+    SECTION("with enum keys") {
+        auto eq = event_queue<key>();
+        auto dense = event_queue<dense_key>();
+        eq.add_handler<const tick&>(RESIZED, on_tick);
+        dense.add_handler<const tick&>(dense_key::RESIZED, on_tick);
+        eq.fire(RESIZED, tick { 1.0, 1 });
+        dense.fire(dense_key::RESIZED, tick { 1.0, 1 });
+
+        REQUIRE(allocations_in([&] {
+            eq.fire(RESIZED, tick { 1.0, 1 });
+            eq.fire(CLOSED, tick { 1.0, 1 });
+            dense.fire(dense_key::RESIZED, tick { 1.0, 1 });
+            dense.fire(dense_key::CLOSED, tick { 1.0, 1 });
+        }) == 0);
+        REQUIRE(sum == 4);
+    }
+
+    SECTION("with interned and literal string keys") {
+        string_pool pool;
+        auto eq = event_queue<symbol>();
+        auto moved = pool.intern("market.data.equities.level2.snapshot.updated");
+        eq.add_handler<const tick&>(symbol(moved), on_tick);
+        auto strings = event_queue<string>();
+        strings.add_handler<const tick&>("market.data.equities.level2.snapshot.updated", on_tick);
+
+        REQUIRE(allocations_in([&] {
+            eq.fire(symbol(moved), tick { 1.0, 1 });
+            eq.fire(pool.find("market.data.equities.level2.snapshot.updated"), tick { 1.0, 1 });
+            strings.fire("market.data.equities.level2.snapshot.updated", tick { 1.0, 1 });
+            strings.fire("market.data.equities.level2.snapshot.unknown", tick { 1.0, 1 });
+        }) == 0);
+        REQUIRE(sum == 3);
+    }
+
+    SECTION("through channels, static queues and several parameters") {
+        auto eq = event_queue<int>();
+        eq.add_handler<const tick&>(0, on_tick);
+        eq.add_handler<int, const tick&>(1, [&sum](int i, const tick& t) { sum += i * t.quantity; });
+        eq.add_handler(2, [&sum]() { ++sum; });
+        auto channel = eq.channel<const tick&>(0);
+        auto static_eq = static_event_queue<::moved, closed>();
+        static_eq.add_handler<::moved>(on_tick);
+        static_eq.add_handler<closed>([&sum]() { ++sum; });
+
+        REQUIRE(allocations_in([&] {
+            channel.fire(tick { 1.0, 1 });
+            eq.fire(1, 2, tick { 1.0, 1 });
+            eq.fire(2);
+            static_eq.fire<::moved>(tick { 1.0, 1 });
+            static_eq.fire<closed>();
+        }) == 0);
+        REQUIRE(sum == 6);
+    }
+
+    SECTION("when a handler removes another, and the handlers are compacted afterwards") {
+        auto eq = event_queue<int>();
+        auto victim = eq.add_handler<const tick&>(0, on_tick);
+        auto removed = false;
+        eq.add_handler<const tick&>(0, [&](const tick&) {
+            if (!removed)
+                eq.remove_handler(victim);
+            removed = true;
+        }, 1);
+
+        REQUIRE(allocations_in([&] {
+            eq.fire(0, tick { 1.0, 1 });
+            eq.fire(0, tick { 1.0, 1 });
+        }) == 0);
+        REQUIRE(victim.removed());
+        REQUIRE(sum == 0);
+    }
+
+    SECTION("when queued events are dispatched, once the queue has grown") {
+        auto eq = event_queue<int>();
+        eq.add_handler<const tick&>(0, on_tick);
+        for (auto i = 0; i < 100; ++i)
+            eq.enqueue(0, tick { 1.0, 1 });
+        eq.dispatch();
+
+        REQUIRE(allocations_in([&] {
+            for (auto i = 0; i < 100; ++i)
+                eq.enqueue(0, tick { 1.0, 1 });
+            eq.dispatch();
+        }) == 0);
+        REQUIRE(sum == 200);
+    }
+
+    SECTION("when handlers queue events while they are dispatched") {
+        auto eq = event_queue<int>();
+        eq.add_handler<const tick&>(0, [&](const tick& t) {
+            sum += t.quantity;
+            eq.enqueue(1, tick { 1.0, 1 });
+        });
+        eq.add_handler<const tick&>(1, on_tick);
+        eq.enqueue(0, tick { 1.0, 1 });
+        eq.dispatch();
+        eq.dispatch();
+
+        REQUIRE(allocations_in([&] {
+            for (auto frame = 0; frame < 10; ++frame) {
+                eq.enqueue(0, tick { 1.0, 1 });
+                eq.dispatch();
+            }
+            eq.dispatch();
+        }) == 0);
+        REQUIRE(sum == 22);
+    }
+
+    SECTION("when coalesced events are posted and dispatched, once each event has been posted") {
+        auto eq = event_queue<int>();
+        coalescing_queue<int> cq(eq);
+        eq.add_handler<const tick&>(0, on_tick);
+        eq.add_handler(1, [&sum]() { ++sum; });
+        auto length = size_t{0};
+        eq.add_handler<const string&>(2, [&length](const string& s) { length += s.size(); });
+        auto text = string(100, 'a');
+        cq.post(0, tick { 1.0, 1 });
+        cq.post(1);
+        cq.post(2, text);
+        cq.dispatch();
+
+        REQUIRE(allocations_in([&] {
+            for (auto i = 0; i < 100; ++i) {
+                cq.post(0, tick { 1.0, i });
+                cq.post(1);
+                cq.post(2, text);
+            }
+            cq.dispatch();
+        }) == 0);
+        REQUIRE(sum == 2 + 99 + 1);
+        REQUIRE(length == 200);
+    }
+}
@@ -28,6 +28,13 @@ TEST_CASE("any_t", "[any_t]") {
         REQUIRE_THROWS_AS(any_t::cast<int>(lazy), bad_cast);
     }
 
+    SECTION("type ids are unique per type") {
+        STATIC_REQUIRE(type_id<int>() == type_id<int>());
+        REQUIRE(type_id<int>() != type_id<long>());
+        REQUIRE(type_id<int>() != type_id<const int>());
+        REQUIRE(type_id<string>() != type_id<const char*>());
+    }
+
     SECTION("works with move") {
         auto sp = unique_ptr<string>(new string("test"));
         auto lazy = any_t::create(move(sp));
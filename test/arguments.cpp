@@ -54,6 +54,55 @@ TEST_CASE("works with different argument types", "[arguments]") {
         eq.fire("test0");
     }
 
+    SECTION("works with a const reference") {
+        struct counted {
+            int* copies;
+            counted(int* c) : copies{c} {}
+            counted(const counted& other) : copies{other.copies} { ++*copies; }
+        };
+
+        auto copies = 0;
+        auto calls = 0;
+        auto eq = event_queue<string>();
+        for (auto i = 0; i < 10; ++i) {
+            eq.add_handler<const counted&>("test0", [&](const counted& c) {
+                REQUIRE(c.copies == &copies);
+                ++calls;
+            });
+        }
+
+        auto original = counted(&copies);
+        eq.fire("test0", original);
+        eq.fire("test0", counted(&copies));
+        REQUIRE(calls == 20);
+        REQUIRE(copies == 0);
+
+        eq.add_handler<counted>("test0", [](counted) { return; });
+        eq.fire("test0", original);
+        REQUIRE(copies == 1);
+    }
+
+    SECTION("works with the type given explicitly") {
+        auto eq = event_queue<string>();
+        auto sum = 0;
+        auto text = string();
+        eq.add_handler<int>("test0", [&sum](int i) { sum += i; });
+        eq.add_handler<string>("test1", [&text](const string& s) { text += s; });
+
+        int x = 3;
+        const int y = 4;
+        eq.fire<int>("test0", x);
+        eq.fire<int>("test0", y);
+        eq.fire<int>("test0", 5);
+        eq.fire<int>(string("test0"), x);
+        eq.fire<string>("test1", "literal");
+        eq.enqueue<int>("test0", x);
+        eq.fire_async<int>("test0", x);
+        eq.dispatch();
+        REQUIRE(sum == 3 + 4 + 5 + 3 + 3 + 3);
+        REQUIRE(text == "literal");
+    }
+
     SECTION("throws on different types") {
         auto eq = event_queue<string>();
         eq.add_handler("test0", []() {
@@ -73,3 +122,87 @@ TEST_CASE("works with different argument types", "[arguments]") {
     }
 }
 
+
+TEST_CASE("works with several arguments", "[arguments]") {
+    struct order {
+        int id;
+        int* copies;
+        order(int i, int* c) : id{i}, copies{c} {}
+        order(const order& other) : id{other.id}, copies{other.copies} { ++*copies; }
+    };
+
+    SECTION("passes each argument to the handlers") {
+        auto copies = 0;
+        auto calls = 0;
+        auto eq = event_queue<string>();
+        eq.add_handler<int, double, const order&>("test0", [&](int i, double d, const order& o) {
+            REQUIRE(i == 1);
+            REQUIRE(d == 2.0);
+            REQUIRE(o.id == 3);
+            ++calls;
+        });
+        eq.add_handler<int, double, const order&>("test0", [&](const int& i, const double&, const order&) {
+            REQUIRE(i == 1);
+            ++calls;
+        });
+
+        auto o = order(3, &copies);
+        eq.fire("test0", 1, 2.0, o);
+        eq.fire(string("test0"), 1, 2.0, order(3, &copies));
+        REQUIRE(calls == 4);
+        REQUIRE(copies == 0);
+    }
+
+    SECTION("converts string literals") {
+        auto eq = event_queue<int>();
+        eq.add_handler<const char*, string>(0, [](const char* s, const string& t) {
+            REQUIRE_THAT(s, Catch::Equals("first"));
+            REQUIRE(t == "second");
+        });
+        eq.fire(0, "first", string("second"));
+    }
+
+    SECTION("removes handlers") {
+        auto calls = 0;
+        auto eq = event_queue<int>();
+        auto info = eq.add_handler<int, int>(0, [&](int a, int b) { calls += a + b; });
+        eq.fire(0, 1, 2);
+        eq.remove_handler(info);
+        eq.fire(0, 1, 2);
+        REQUIRE(calls == 3);
+        REQUIRE(info.removed());
+    }
+
+    SECTION("fires through a channel") {
+        auto sum = 0;
+        auto eq = event_queue<int>();
+        eq.add_handler<int, int, int>(0, [&](int a, int b, int c) { sum += a * b * c; });
+        auto channel = eq.channel<int, int, int>(0);
+        channel.fire(2, 3, 4);
+        REQUIRE(sum == 24);
+    }
+
+    SECTION("queues the arguments") {
+        auto calls = 0;
+        auto eq = event_queue<int>();
+        eq.add_handler<string, int>(0, [&](const string& s, int i) {
+            REQUIRE(s == "test");
+            REQUIRE(i == calls);
+            ++calls;
+        });
+        eq.enqueue(0, string("test"), 0);
+        eq.enqueue(0, string("test"), 1);
+        REQUIRE(calls == 0);
+        REQUIRE(eq.dispatch() == 2);
+        REQUIRE(calls == 2);
+    }
+
+    SECTION("throws on different types") {
+        auto eq = event_queue<int>();
+        eq.add_handler<int, int>(0, [](int, int) { return; });
+        REQUIRE_THROWS_AS(eq.fire(0, 1), invalid_argument);
+        REQUIRE_THROWS_AS(eq.fire(0, 1, 2, 3), invalid_argument);
+        REQUIRE_THROWS_AS(eq.fire(0, 1, 2.0), bad_cast);
+        REQUIRE_THROWS_AS(eq.add_handler<int>(0, [](int) { return; }), invalid_argument);
+    }
+}
@@ -0,0 +1,72 @@
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include "catch.hpp"
+#include "../eventus.hpp"
+
+using namespace eventus;
+using namespace std;
+
+TEST_CASE("fire_async", "[async]") {
+    SECTION("runs every handler on the pool") {
+        worker_pool pool(4);
+        auto eq = event_queue<string>(pool);
+        atomic<int> total(0);
+        atomic<int> calls(0);
+        for (auto i = 0; i < 8; ++i) {
+            eq.add_handler<int>("event", [&](int x) {
+                total += x;
+                ++calls;
+            });
+        }
+        eq.add_handler("other", [&]() { ++calls; });
+
+        for (auto i = 0; i < 100; ++i)
+            eq.fire_async("event", 2);
+        eq.fire_async("other");
+        pool.wait();
+
+        REQUIRE(calls == 801);
+        REQUIRE(total == 1600);
+    }
+
+    SECTION("runs handlers on the firing thread without a pool") {
+        auto eq = event_queue<int>();
+        auto calls = 0;
+        eq.add_handler<int>(0, [&](int x) { calls += x; });
+
+        eq.fire_async(0, 3);
+        REQUIRE(calls == 3);
+    }
+
+    SECTION("handlers can be added and removed while tasks are running") {
+        worker_pool pool(2);
+        auto eq = event_queue<int>(pool);
+        atomic<int> calls(0);
+        auto info = eq.add_handler<int>(0, [&](int) { ++calls; });
+
+        for (auto i = 0; i < 50; ++i)
+            eq.fire_async(0, i);
+        eq.add_handler<int>(0, [&](int) { ++calls; });
+        eq.remove_handler(info);
+        for (auto i = 0; i < 50; ++i)
+            eq.fire_async(0, i);
+        pool.wait();
+
+        REQUIRE(calls == 100);
+
+        calls = 0;
+        eq.fire(0, 0);
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("wait rethrows the first exception thrown by a handler") {
+        worker_pool pool(2);
+        auto eq = event_queue<int>(pool);
+        eq.add_handler<int>(0, [](int) { throw runtime_error("handler failed"); });
+
+        eq.fire_async(0, 1);
+        REQUIRE_THROWS_AS(pool.wait(), runtime_error);
+        pool.wait();
+    }
+}
@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <thread>
+#include "bench.hpp"
+
+using namespace std;
+
+namespace {
+    atomic<long> allocations(0);
+}
+
+// Counts every heap allocation, so benchmarks can report allocations per iteration.
+void* operator new(size_t size) {
+    allocations.fetch_add(1, memory_order_relaxed);
+    if (void* p = malloc(size == 0 ? 1 : size))
+        return p;
+    throw bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    free(p);
+}
+
+namespace bench {
+    volatile int sink = 0;
+
+    long allocation_count() {
+        return allocations.load(memory_order_relaxed);
+    }
+
+    namespace {
+        struct options {
+            bool json = false;
+            string filter;
+            double min_time = 0.2;
+        };
+
+        struct result {
+            string name;
+            long iterations;
+            double ns_per_op;
+            long items_processed;
+            double allocations_per_op;
+            double seconds;
+            map<string, double> counters;
+        };
+
+        bool starts_with(const char* s, const char* prefix, const char*& rest) {
+            auto length = strlen(prefix);
+            if (strncmp(s, prefix, length) != 0)
+                return false;
+            rest = s + length;
+            return true;
+        }
+
+        bool parse(int argc, char** argv, options& opts) {
+            for (auto i = 1; i < argc; ++i) {
+                const char* value;
+                if (strcmp(argv[i], "--json") == 0)
+                    opts.json = true;
+                else if (starts_with(argv[i], "--filter=", value))
+                    opts.filter = value;
+                else if (starts_with(argv[i], "--min-time=", value))
+                    opts.min_time = atof(value);
+                else {
+                    fprintf(stderr, "usage: %s [--json] [--filter=<substring>] [--min-time=<seconds>]\n", argv[0]);
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Runs a benchmark with more iterations each time, until it takes at least min_time.
+        result measure(const benchmark& b, double min_time) {
+            long iterations = 1;
+            for (;;) {
+                auto s = state(iterations, b.arg);
+                b.fn(s);
+
+                auto seconds = s.seconds();
+                if (seconds >= min_time || iterations >= 1000000000L) {
+                    auto items = s.items_processed() * s.iterations();
+                    auto allocations_per_op = static_cast<double>(s.allocations()) / iterations;
+                    return { b.name, iterations, seconds * 1e9 / iterations, items, allocations_per_op, seconds,
+                             s.counters };
+                }
+
+                // Aim a little past min_time, without jumping too far on a noisy short run
+                auto factor = seconds <= 0 ? 10.0 : min(10.0, max(2.0, 1.4 * min_time / seconds));
+                iterations = static_cast<long>(iterations * factor);
+            }
+        }
+
+        void print_text(const result& r) {
+            printf("%-44s %12.2f ns/op %12ld iterations %8.2f allocs/op", r.name.c_str(), r.ns_per_op, r.iterations,
+                   r.allocations_per_op);
+            if (r.items_processed != 0)
+                printf(" %10.2f M items/s", r.items_processed / r.seconds / 1e6);
+            for (const auto& c : r.counters)
+                printf(" %10.2f %s", c.second, c.first.c_str());
+            printf("\n");
+        }
+
+        void print_json(const vector<result>& results) {
+            printf("{\n");
+            printf("  \"context\": {\n");
+            printf("    \"num_cpus\": %u\n", thread::hardware_concurrency());
+            printf("  },\n");
+            printf("  \"benchmarks\": [\n");
+            for (size_t i = 0; i < results.size(); ++i) {
+                const auto& r = results[i];
+                printf("    {\n");
+                printf("      \"name\": \"%s\",\n", r.name.c_str());
+                printf("      \"iterations\": %ld,\n", r.iterations);
+                printf("      \"allocs_per_op\": %.6g,\n", r.allocations_per_op);
+                if (r.items_processed != 0)
+                    printf("      \"items_per_second\": %.6g,\n", r.items_processed / r.seconds);
+                for (const auto& c : r.counters)
+                    printf("      \"%s\": %.6g,\n", c.first.c_str(), c.second);
+                printf("      \"real_time\": %.6g,\n", r.ns_per_op);
+                printf("      \"time_unit\": \"ns\"\n");
+                printf("    }%s\n", i + 1 < results.size() ? "," : "");
+            }
+            printf("  ]\n");
+            printf("}\n");
+        }
+    }
+
+    int run(int argc, char** argv) {
+        auto opts = options();
+        if (!parse(argc, argv, opts))
+            return 1;
+
+        auto results = vector<result>();
+        for (const auto& b : registry()) {
+            if (b.name.find(opts.filter) == string::npos)
+                continue;
+            results.push_back(measure(b, opts.min_time));
+            if (!opts.json)
+                print_text(results.back());
+        }
+        if (opts.json)
+            print_json(results);
+        return 0;
+    }
+}
+
+int main(int argc, char** argv) {
+    return bench::run(argc, argv);
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <chrono>
+#include <initializer_list>
+#include <map>
+#include <string>
+#include <vector>
+
+// A small benchmark harness in the style of Google Benchmark, so the suite builds with nothing but the header.
+//
+// Benchmarks are registered with EVENTUS_BENCH, once per argument, and loop while state.keep_running():
+//
+//     void fire_int(bench::state& state) {
+//         ... setup, using state.arg() ...
+//         while (state.keep_running())
+//             eq.fire(0, 1);
+//     }
+//     EVENTUS_BENCH("fire/int", fire_int, { 1, 8, 64 });
+//
+// Each benchmark is run with more iterations until it takes at least --min-time seconds. The bench executable replaces
+// the global operator new to count heap allocations, which are reported per iteration along with the time. Run
+// `bench --json` to print the results as JSON, and `bench --filter=fire/` to only run benchmarks whose names contain
+// "fire/".
+namespace bench {
+    // Handlers write here, so the compiler can't optimize them away.
+    extern volatile int sink;
+
+    /// The number of calls to operator new so far, on any thread.
+    long allocation_count();
+
+    class state {
+    public:
+        typedef std::chrono::steady_clock clock;
+
+        state(long iterations, long arg) : _iterations{iterations}, _arg{arg}, _done{0}, _items{0}, _allocations{0} {}
+
+        /// Returns true while there are iterations left to run. Timing starts with the first call.
+        bool keep_running() {
+            if (_done == 0)
+                resume_timing();
+            if (_done++ < _iterations)
+                return true;
+            pause_timing();
+            return false;
+        }
+
+        /// Stops the clock, and the allocation count, for setup work inside the loop.
+        void pause_timing() {
+            _elapsed += clock::now() - _start;
+            _allocations += allocation_count() - _allocations_start;
+        }
+        void resume_timing() {
+            _allocations_start = allocation_count();
+            _start = clock::now();
+        }
+
+        /// The argument the benchmark was registered with.
+        long arg() const { return _arg; }
+        long iterations() const { return _iterations; }
+
+        /// Reports items_per_second along with the time, e.g. for benchmarks doing a batch of work per iteration.
+        void set_items_processed(long items) { _items = items; }
+
+        /// Extra values to report, e.g. copies per iteration.
+        std::map<std::string, double> counters;
+
+        double seconds() const { return std::chrono::duration<double>(_elapsed).count(); }
+        long items_processed() const { return _items; }
+        long allocations() const { return _allocations; }
+
+    private:
+        long _iterations;
+        long _arg;
+        long _done;
+        long _items;
+        long _allocations;
+        long _allocations_start = 0;
+        clock::time_point _start;
+        clock::duration _elapsed = clock::duration::zero();
+    };
+
+    typedef void (*function)(state&);
+
+    struct benchmark {
+        std::string name;
+        function fn;
+        long arg;
+    };
+
+    inline std::vector<benchmark>& registry() {
+        static std::vector<benchmark> benchmarks;
+        return benchmarks;
+    }
+
+    struct registration {
+        registration(const char* name, function fn, std::initializer_list<long> args) {
+            for (auto arg : args)
+                registry().push_back({ std::string(name) + "/" + std::to_string(arg), fn, arg });
+        }
+        registration(const char* name, function fn) {
+            registry().push_back({ name, fn, 0 });
+        }
+    };
+
+    /// Runs the registered benchmarks, configured by the command line.
+    int run(int argc, char** argv);
+}
+
+#define EVENTUS_BENCH_CONCAT_(a, b) a##b
+#define EVENTUS_BENCH_CONCAT(a, b) EVENTUS_BENCH_CONCAT_(a, b)
+#define EVENTUS_BENCH(...) static bench::registration EVENTUS_BENCH_CONCAT(bench_registration_, __LINE__)(__VA_ARGS__)
@@ -0,0 +1,187 @@
+#include <string>
+#include "bench.hpp"
+#include "../eventus.hpp"
+
+using namespace eventus;
+using namespace std;
+
+namespace {
+    enum class dense_key : unsigned { MOVED, RESIZED, CLOSED, COUNT };
+}
+
+namespace eventus {
+    template<> struct event_key_bound<dense_key> : integral_constant<size_t, static_cast<size_t>(dense_key::COUNT)> {};
+}
+
+namespace {
+    enum key { MOVED, RESIZED, CLOSED };
+    enum class scoped_key : unsigned { MOVED, RESIZED, CLOSED };
+
+    const char* const TOPIC = "market.data.equities.level2.snapshot.updated";
+
+    template<typename event_type>
+    void fire(bench::state& state, event_type event) {
+        auto eq = event_queue<event_type>();
+        for (long i = 0; i < state.arg(); ++i)
+            eq.template add_handler<int>(event_type(event), [](int i) { bench::sink += i; });
+
+        auto i = 0;
+        while (state.keep_running())
+            eq.fire(event_type(event), ++i);
+    }
+
+    void fire_string(bench::state& state) { fire<string>(state, TOPIC); }
+    void fire_const_char(bench::state& state) { fire<const char*>(state, TOPIC); }
+    void fire_int(bench::state& state) { fire<int>(state, 42); }
+    void fire_enum(bench::state& state) { fire<key>(state, RESIZED); }
+    void fire_scoped_enum(bench::state& state) { fire<scoped_key>(state, scoped_key::RESIZED); }
+    void fire_dense_enum(bench::state& state) { fire<dense_key>(state, dense_key::RESIZED); }
+
+    EVENTUS_BENCH("fire/string", fire_string, { 1, 8, 64 });
+    EVENTUS_BENCH("fire/const_char", fire_const_char, { 1, 8, 64 });
+    EVENTUS_BENCH("fire/int", fire_int, { 0, 1, 8, 64 });
+    EVENTUS_BENCH("fire/enum", fire_enum, { 1, 8, 64 });
+    EVENTUS_BENCH("fire/scoped_enum", fire_scoped_enum, { 1, 8, 64 });
+    EVENTUS_BENCH("fire/dense_enum", fire_dense_enum, { 0, 1, 8, 64 });
+
+    struct resized { using payload = int; };
+    struct closed { using payload = void; };
+
+    void fire_static(bench::state& state) {
+        auto eq = static_event_queue<closed, resized>();
+        for (long i = 0; i < state.arg(); ++i)
+            eq.add_handler<resized>([](int i) { bench::sink += i; });
+
+        auto i = 0;
+        while (state.keep_running())
+            eq.fire<resized>(++i);
+    }
+    EVENTUS_BENCH("fire/static", fire_static, { 0, 1, 8, 64 });
+
+    void fire_symbol(bench::state& state) {
+        string_pool pool;
+        auto topic = pool.intern(TOPIC);
+        fire<symbol>(state, topic);
+    }
+    EVENTUS_BENCH("fire/symbol", fire_symbol, { 1, 8, 64 });
+
+    // Looks the symbol up by its name on every fire, as when the name comes from outside.
+    void fire_symbol_lookup(bench::state& state) {
+        string_pool pool;
+        auto eq = event_queue<symbol>();
+        for (long i = 0; i < state.arg(); ++i)
+            eq.add_handler<int>(pool.intern(TOPIC), [](int i) { bench::sink += i; });
+
+        auto i = 0;
+        while (state.keep_running())
+            eq.fire(pool.find(TOPIC), ++i);
+    }
+    EVENTUS_BENCH("fire/symbol_lookup", fire_symbol_lookup, { 1, 8, 64 });
+
+    // Fires an event_queue<std::string> by a string literal, which is looked up without constructing a std::string.
+    void fire_string_literal(bench::state& state) {
+        auto eq = event_queue<string>();
+        for (long i = 0; i < state.arg(); ++i)
+            eq.add_handler<int>(TOPIC, [](int i) { bench::sink += i; });
+
+        auto i = 0;
+        while (state.keep_running())
+            eq.fire("market.data.equities.level2.snapshot.updated", ++i);
+    }
+    EVENTUS_BENCH("fire/string_literal", fire_string_literal, { 1, 8, 64 });
+
+    void fire_unknown_event(bench::state& state) {
+        auto eq = event_queue<string>();
+        eq.add_handler<int>(TOPIC, [](int i) { bench::sink += i; });
+
+        auto i = 0;
+        while (state.keep_running())
+            eq.fire("no.such.event", ++i);
+    }
+    EVENTUS_BENCH("fire/string_unknown", fire_unknown_event);
+
+    template<typename event_type>
+    void channel(bench::state& state, event_type event) {
+        auto eq = event_queue<event_type>();
+        for (long i = 0; i < state.arg(); ++i)
+            eq.template add_handler<int>(event_type(event), [](int i) { bench::sink += i; });
+
+        auto ch = eq.template channel<int>(event_type(event));
+        auto i = 0;
+        while (state.keep_running())
+            ch.fire(++i);
+    }
+
+    void channel_string(bench::state& state) { channel<string>(state, TOPIC); }
+    void channel_int(bench::state& state) { channel<int>(state, 42); }
+
+    EVENTUS_BENCH("channel/string", channel_string, { 1, 8, 64 });
+    EVENTUS_BENCH("channel/int", channel_int, { 1, 8, 64 });
+
+    // Three parameters, passed straight through to each handler.
+    void fire_arguments(bench::state& state) {
+        auto eq = event_queue<int>();
+        for (long i = 0; i < state.arg(); ++i) {
+            eq.add_handler<int, double, const string&>(42, [](int i, double d, const string& s) {
+                bench::sink += i + static_cast<int>(d) + static_cast<int>(s.size());
+            });
+        }
+
+        auto text = string(TOPIC);
+        auto i = 0;
+        while (state.keep_running())
+            eq.fire(42, ++i, 2.0, text);
+    }
+    EVENTUS_BENCH("fire/arguments", fire_arguments, { 1, 8, 64 });
+
+    // state.arg() handlers behind one with a higher priority, which consumes the event.
+    void fire_consumed(bench::state& state) {
+        auto eq = event_queue<int>();
+        eq.add_handler<int>(42, [](int i) {
+            bench::sink += i;
+            return true;
+        }, 1);
+        for (long i = 0; i < state.arg(); ++i)
+            eq.add_handler<int>(42, [](int i) { bench::sink += i; });
+
+        auto i = 0;
+        while (state.keep_running())
+            eq.fire(42, ++i);
+    }
+    EVENTUS_BENCH("fire/consumed", fire_consumed, { 1, 64, 512 });
+
+    // Each handler fires the next event, state.arg() events deep.
+    void fire_nested(bench::state& state) {
+        auto eq = event_queue<int>();
+        auto depth = static_cast<int>(state.arg());
+        for (auto level = 0; level < depth; ++level) {
+            eq.add_handler<int>(int(level), [&eq, level, depth](int i) {
+                if (level + 1 < depth)
+                    eq.fire(level + 1, i);
+                else
+                    bench::sink += i;
+            });
+        }
+
+        auto i = 0;
+        while (state.keep_running())
+            eq.fire(0, ++i);
+    }
+    EVENTUS_BENCH("fire_nested/int", fire_nested, { 1, 2, 4, 16 });
+
+    // The same event fired again from its own handler, state.arg() times.
+    void fire_recursive(bench::state& state) {
+        auto eq = event_queue<int>();
+        auto depth = static_cast<int>(state.arg());
+        eq.add_handler<int>(0, [&eq, depth](int i) {
+            if (i < depth)
+                eq.fire(0, i + 1);
+            else
+                bench::sink += i;
+        });
+
+        while (state.keep_running())
+            eq.fire(0, 1);
+    }
+    EVENTUS_BENCH("fire_recursive/int", fire_recursive, { 1, 4, 16 });
+}
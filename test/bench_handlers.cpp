@@ -0,0 +1,68 @@
+#include <memory>
+#include <vector>
+#include "bench.hpp"
+#include "../eventus.hpp"
+
+using namespace eventus;
+using namespace std;
+
+namespace {
+    void add_remove(bench::state& state) {
+        auto eq = event_queue<int>();
+        for (auto i = 0; i < 4; ++i)
+            eq.add_handler<int>(0, [](int i) { bench::sink += i; });
+
+        while (state.keep_running()) {
+            auto info = eq.add_handler<int>(0, [](int i) { bench::sink += i; });
+            eq.remove_handler(info);
+        }
+    }
+    EVENTUS_BENCH("add_remove/churn", add_remove);
+
+    // Removes and re-adds one handler of an event with state.arg() handlers.
+    void add_remove_among(bench::state& state) {
+        auto eq = event_queue<int>();
+        // handler_info isn't assignable
+        auto infos = vector<unique_ptr<handler_info<int, int>>>();
+        for (long i = 0; i < state.arg(); ++i)
+            infos.emplace_back(new handler_info<int, int>(eq.add_handler<int>(0, [](int i) { bench::sink += i; })));
+
+        size_t next = 0;
+        while (state.keep_running()) {
+            auto& info = infos[next++ % infos.size()];
+            eq.remove_handler(*info);
+            info.reset(new handler_info<int, int>(eq.add_handler<int>(0, [](int i) { bench::sink += i; })));
+        }
+    }
+    EVENTUS_BENCH("add_remove/among", add_remove_among, { 10, 1000, 50000 });
+
+    void add_handler(bench::state& state) {
+        auto eq = event_queue<int>();
+        auto event = 0;
+        while (state.keep_running())
+            eq.add_handler<int>(event++ % 1000, [](int i) { bench::sink += i; });
+    }
+    EVENTUS_BENCH("add_handler/1000_events", add_handler);
+
+    // Fires 4 handlers after state.arg() add/remove cycles. Unless removed handlers are reclaimed, the cost grows with
+    // the number of cycles. The churned queue is kept for reruns with more iterations, so the cycles run once per arg.
+    void fire_after_churn(bench::state& state) {
+        static unique_ptr<event_queue<int>> eq;
+        static long churned = -1;
+        if (!eq || churned != state.arg()) {
+            eq.reset(new event_queue<int>());
+            for (auto i = 0; i < 4; ++i)
+                eq->add_handler<int>(0, [](int i) { bench::sink += i; });
+            for (long i = 0; i < state.arg(); ++i) {
+                auto info = eq->add_handler<int>(0, [](int i) { bench::sink += i; });
+                eq->remove_handler(info);
+            }
+            churned = state.arg();
+        }
+
+        auto i = 0;
+        while (state.keep_running())
+            eq->fire(0, ++i);
+    }
+    EVENTUS_BENCH("fire_after_churn", fire_after_churn, { 0, 10000000 });
+}
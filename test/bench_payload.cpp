@@ -0,0 +1,50 @@
+#include <algorithm>
+#include <cstddef>
+#include "bench.hpp"
+#include "../eventus.hpp"
+
+using namespace eventus;
+using namespace std;
+
+namespace {
+    const int NUM_HANDLERS = 10;
+
+    // A payload of SIZE bytes which counts how often it is copied.
+    template<size_t SIZE>
+    struct payload {
+        static long copies;
+        unsigned char bytes[SIZE];
+
+        payload() { fill(bytes, bytes + SIZE, 1); }
+        payload(const payload& other) {
+            ++copies;
+            copy(other.bytes, other.bytes + SIZE, bytes);
+        }
+    };
+    template<size_t SIZE> long payload<SIZE>::copies = 0;
+
+    template<typename T, typename P>
+    void fire_payload(bench::state& state) {
+        auto eq = event_queue<int>();
+        for (auto i = 0; i < NUM_HANDLERS; ++i)
+            eq.add_handler<T>(0, [](T p) { bench::sink += p.bytes[0]; });
+
+        auto p = P();
+        P::copies = 0;
+        while (state.keep_running())
+            eq.fire(0, p);
+        state.counters["copies_per_op"] = static_cast<double>(P::copies) / state.iterations();
+    }
+
+    template<size_t SIZE> void by_value(bench::state& state) { fire_payload<payload<SIZE>, payload<SIZE>>(state); }
+    template<size_t SIZE> void by_ref(bench::state& state) { fire_payload<const payload<SIZE>&, payload<SIZE>>(state); }
+
+    EVENTUS_BENCH("payload/value_10_handlers/8", by_value<8>);
+    EVENTUS_BENCH("payload/value_10_handlers/64", by_value<64>);
+    EVENTUS_BENCH("payload/value_10_handlers/512", by_value<512>);
+    EVENTUS_BENCH("payload/value_10_handlers/4096", by_value<4096>);
+    EVENTUS_BENCH("payload/cref_10_handlers/8", by_ref<8>);
+    EVENTUS_BENCH("payload/cref_10_handlers/64", by_ref<64>);
+    EVENTUS_BENCH("payload/cref_10_handlers/512", by_ref<512>);
+    EVENTUS_BENCH("payload/cref_10_handlers/4096", by_ref<4096>);
+}
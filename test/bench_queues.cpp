@@ -0,0 +1,135 @@
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bench.hpp"
+#include "../eventus.hpp"
+
+using namespace eventus;
+using namespace std;
+
+namespace {
+    const long BATCH = 1000;
+
+    template<typename event_type>
+    void enqueue_dispatch(bench::state& state, event_type event) {
+        auto eq = event_queue<event_type>();
+        eq.template add_handler<int>(event_type(event), [](int i) { bench::sink += i; });
+
+        long i = 0;
+        while (state.keep_running()) {
+            eq.enqueue(event_type(event), static_cast<int>(++i));
+            if (i % BATCH == 0)
+                eq.dispatch();
+        }
+        eq.dispatch();
+    }
+
+    void enqueue_dispatch_string(bench::state& state) {
+        enqueue_dispatch<string>(state, "market.data.equities.level2.snapshot.updated");
+    }
+    void enqueue_dispatch_int(bench::state& state) { enqueue_dispatch<int>(state, 42); }
+
+    EVENTUS_BENCH("enqueue_dispatch/string", enqueue_dispatch_string);
+    EVENTUS_BENCH("enqueue_dispatch/int", enqueue_dispatch_int);
+
+    void ring_post_pump(bench::state& state) {
+        auto eq = event_queue<int>();
+        eq.add_handler<int>(0, [](int i) { bench::sink += i; });
+
+        event_ring<int> ring(eq, 1024);
+        long i = 0;
+        while (state.keep_running()) {
+            ring.post(0, static_cast<int>(++i));
+            if (i % BATCH == 0)
+                ring.pump();
+        }
+        ring.pump();
+    }
+    EVENTUS_BENCH("ring/post_pump", ring_post_pump);
+
+    // Posts a batch of updates to 8 events per dispatch, which fires each event once.
+    void coalescing_post_dispatch(bench::state& state) {
+        auto eq = event_queue<int>();
+        for (auto e = 0; e < 8; ++e)
+            eq.add_handler<int>(int(e), [](int i) { bench::sink += i; });
+
+        coalescing_queue<int> cq(eq);
+        long i = 0;
+        while (state.keep_running()) {
+            cq.post(static_cast<int>(i % 8), static_cast<int>(i));
+            if (++i % BATCH == 0)
+                cq.dispatch();
+        }
+        cq.dispatch();
+    }
+    EVENTUS_BENCH("coalescing/post_dispatch", coalescing_post_dispatch);
+
+    // Fires FIRES events from each of state.arg() threads per iteration.
+    const long FIRES = 10000;
+
+    template<typename F>
+    void fire_threads(bench::state& state, F fire) {
+        auto num_threads = static_cast<int>(state.arg());
+        while (state.keep_running()) {
+            auto threads = vector<thread>();
+            for (auto t = 0; t < num_threads; ++t) {
+                threads.emplace_back([&]() {
+                    for (long i = 0; i < FIRES; ++i)
+                        fire(static_cast<int>(i));
+                });
+            }
+            for (auto& t : threads)
+                t.join();
+        }
+        state.set_items_processed(FIRES * num_threads);
+    }
+
+    // sink isn't safe to share between threads, and an atomic would measure contention on it instead
+    void concurrent_fire(bench::state& state) {
+        concurrent_event_queue<int> ceq;
+        ceq.add_handler<int>(0, [](int) { return; });
+        fire_threads(state, [&](int i) { ceq.fire(0, i); });
+    }
+
+    void mutex_fire(bench::state& state) {
+        auto eq = event_queue<int>();
+        mutex eq_mutex;
+        eq.add_handler<int>(0, [](int) { return; });
+        fire_threads(state, [&](int i) {
+            lock_guard<mutex> lock(eq_mutex);
+            eq.fire(0, i);
+        });
+    }
+
+    EVENTUS_BENCH("threads/concurrent_event_queue", concurrent_fire, { 1, 2, 4, 8, 16, 32 });
+    EVENTUS_BENCH("threads/event_queue_mutex", mutex_fire, { 1, 2, 4, 8, 16, 32 });
+
+    // A handler which keeps a core busy for a while. It runs on several threads at once, so it can't use sink.
+    void spin(int i) {
+        volatile int x = i;
+        for (auto n = 0; n < 20000; ++n)
+            x = x * 31 + n;
+    }
+
+    // Fires an event with 8 busy handlers and waits for them, on the firing thread (0) or on the pool (1).
+    void fire_busy(bench::state& state) {
+        worker_pool pool;
+        auto eq = event_queue<int>(pool);
+        for (auto i = 0; i < 8; ++i)
+            eq.add_handler<int>(0, [](int i) { spin(i); });
+
+        auto i = 0;
+        while (state.keep_running()) {
+            if (state.arg() != 0) {
+                eq.fire_async(0, ++i);
+                pool.wait();
+            }
+            else {
+                eq.fire(0, ++i);
+            }
+        }
+        state.counters["threads"] = static_cast<double>(pool.size());
+    }
+    EVENTUS_BENCH("fire_async/8_busy_handlers", fire_busy, { 0, 1 });
+}
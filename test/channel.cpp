@@ -0,0 +1,73 @@
+#include <string>
+#include "catch.hpp"
+#include "../eventus.hpp"
+
+using namespace eventus;
+using namespace std;
+
+TEST_CASE("event channels", "[channel]") {
+    SECTION("fires handlers added before the channel") {
+        auto eq = event_queue<string>();
+        auto calls = 0;
+        eq.add_handler<int>("event0", [&](int i) {
+            REQUIRE(i == 3);
+            ++calls;
+        });
+        auto ch = eq.channel<int>("event0");
+        ch.fire(3);
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("fires handlers added after the channel") {
+        auto eq = event_queue<string>();
+        auto calls = 0;
+        auto ch = eq.channel<int>("event0");
+        eq.add_handler<int>("event0", [&](int i) {
+            REQUIRE(i == 3);
+            ++calls;
+        });
+        ch.fire(3);
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("works with a void") {
+        auto eq = event_queue<string>();
+        auto calls = 0;
+        auto ch = eq.channel("event0");
+        eq.add_handler("event0", [&]() { ++calls; });
+        ch.fire();
+        eq.fire("event0");
+        REQUIRE(calls == 2);
+    }
+
+    SECTION("doesn't call removed handlers") {
+        auto eq = event_queue<string>();
+        auto calls = 0;
+        auto ch = eq.channel<int>("event0");
+        auto handler0 = eq.add_handler<int>("event0", [](int) {
+            REQUIRE(false);
+        });
+        eq.add_handler<int>("event0", [&](int) { ++calls; });
+        eq.remove_handler(handler0);
+        ch.fire(3);
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("stays valid when other events are added") {
+        auto eq = event_queue<int>();
+        auto calls = 0;
+        auto ch = eq.channel<int>(0);
+        eq.add_handler<int>(0, [&](int) { ++calls; });
+        for (auto i = 1; i < 1000; ++i)
+            eq.add_handler<int>(int(i), [](int) { return; });
+        ch.fire(3);
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("throws on different types") {
+        auto eq = event_queue<string>();
+        eq.add_handler<string>("event0", [](string) { return; });
+        REQUIRE_THROWS_AS(eq.channel<int>("event0"), bad_cast);
+        REQUIRE_THROWS_AS(eq.channel("event0"), invalid_argument);
+    }
+}
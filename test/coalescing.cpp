@@ -0,0 +1,163 @@
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "catch.hpp"
+#include "../eventus.hpp"
+
+using namespace eventus;
+using namespace std;
+
+namespace {
+    struct position {
+        int x;
+        int y;
+    };
+
+    enum class window_event : unsigned { MOVED, RESIZED, CLOSED, COUNT };
+}
+
+namespace eventus {
+    template<> struct event_key_bound<window_event> :
+        integral_constant<size_t, static_cast<size_t>(window_event::COUNT)> {};
+}
+
+TEST_CASE("coalescing queue", "[coalescing]") {
+    auto eq = event_queue<string>();
+    coalescing_queue<string> cq(eq);
+    auto calls = vector<position>();
+    eq.add_handler<const position&>("moved", [&calls](const position& p) { calls.push_back(p); });
+
+    SECTION("fires a burst of posts once, with the last parameter") {
+        for (auto i = 0; i < 10000; ++i)
+            cq.post("moved", position { i, -i });
+        REQUIRE(cq.queued() == 1);
+        REQUIRE(calls.empty());
+
+        REQUIRE(cq.dispatch() == 1);
+        REQUIRE(calls.size() == 1);
+        REQUIRE(calls[0].x == 9999);
+        REQUIRE(calls[0].y == -9999);
+        REQUIRE(cq.queued() == 0);
+
+        REQUIRE(cq.dispatch() == 0);
+        REQUIRE(calls.size() == 1);
+    }
+
+    SECTION("fires events in the order they were first posted") {
+        auto order = string();
+        eq.add_handler("closed", [&order]() { order += "closed "; });
+        eq.add_handler<int>("resized", [&order](int i) { order += "resized " + to_string(i) + " "; });
+
+        cq.post("resized", 1);
+        cq.post("closed");
+        cq.post("resized", 2);
+        cq.post("closed");
+        REQUIRE(cq.queued() == 2);
+        REQUIRE(cq.dispatch() == 2);
+        REQUIRE(order == "resized 2 closed ");
+    }
+
+    SECTION("events posted by handlers") {
+        auto count = 0;
+        eq.add_handler<int>("tick", [&](int i) {
+            ++count;
+            cq.post("tick", i + 1);
+            cq.post("moved", position { i, i });
+        });
+
+        SECTION("are fired by the next dispatch") {
+            cq.post("tick", 0);
+            REQUIRE(cq.dispatch() == 1);
+            REQUIRE(count == 1);
+            REQUIRE(calls.empty());
+            REQUIRE(cq.queued() == 2);
+
+            REQUIRE(cq.dispatch() == 2);
+            REQUIRE(count == 2);
+            REQUIRE(calls.size() == 1);
+            REQUIRE(calls[0].x == 1);
+        }
+
+        SECTION("replace the parameter of events yet to be fired in this dispatch") {
+            cq.post("tick", 0);
+            cq.post("moved", position { 7, 7 });
+            REQUIRE(cq.dispatch() == 2);
+            REQUIRE(calls.size() == 1);
+            REQUIRE(calls[0].x == 0);
+            REQUIRE(cq.queued() == 1);
+        }
+    }
+
+    SECTION("handlers are given the parameter they were posted with, even if they post again") {
+        auto seen = vector<int>();
+        eq.add_handler<const string&>("text", [&](const string& s) {
+            seen.push_back(static_cast<int>(s.size()));
+            cq.post("text", string("a much longer string, which doesn't fit a small string buffer"));
+            seen.push_back(static_cast<int>(s.size()));
+        });
+
+        cq.post("text", string("short"));
+        cq.dispatch();
+        REQUIRE(seen == (vector<int> { 5, 5 }));
+    }
+
+    SECTION("handlers are given the parameter they were posted with, even if another handler posts it without one") {
+        auto text = string("a string long enough to be stored on the heap, not in a small buffer");
+        auto seen = vector<string>();
+        eq.add_handler<const string&>("text", [&](const string& s) {
+            seen.push_back(s);
+            cq.post("text");
+        }, 1);
+        eq.add_handler<const string&>("text", [&](const string& s) { seen.push_back(s); });
+
+        cq.post("text", text);
+        cq.dispatch();
+        REQUIRE(seen == (vector<string> { text, text }));
+        REQUIRE(cq.queued() == 1);
+    }
+
+    SECTION("a mismatched parameter type leaves the events after it posted") {
+        cq.post("moved", 1);
+        cq.post("moved", 2);
+        cq.post("other", position { 1, 2 });
+        REQUIRE_THROWS_AS(cq.dispatch(), bad_cast);
+        REQUIRE(cq.queued() == 1);
+
+        cq.post("moved", position { 3, 4 });
+        REQUIRE(cq.queued() == 2);
+        REQUIRE(cq.dispatch() == 2);
+        REQUIRE(calls.size() == 1);
+        REQUIRE(calls[0].x == 3);
+    }
+
+    SECTION("an event can be posted with another type once it has been fired") {
+        cq.post("moved", position { 1, 2 });
+        cq.dispatch();
+        cq.post("moved");
+        REQUIRE_THROWS_AS(cq.dispatch(), invalid_argument);
+        cq.post("moved", position { 3, 4 });
+        cq.dispatch();
+        REQUIRE(calls.size() == 2);
+        REQUIRE(calls[1].x == 3);
+    }
+
+    SECTION("events without handlers are dropped") {
+        cq.post("unknown", 1);
+        REQUIRE(cq.dispatch() == 1);
+        REQUIRE(calls.empty());
+    }
+}
+
+TEST_CASE("coalescing queue with dense keys", "[coalescing]") {
+    auto eq = event_queue<window_event>();
+    coalescing_queue<window_event> cq(eq);
+    auto sum = 0;
+    eq.add_handler<int>(window_event::MOVED, [&sum](int i) { sum += i; });
+    eq.add_handler(window_event::CLOSED, [&sum]() { sum += 100; });
+
+    for (auto i = 1; i <= 10; ++i)
+        cq.post(window_event::MOVED, int(i));
+    cq.post(window_event::CLOSED);
+    REQUIRE(cq.dispatch() == 2);
+    REQUIRE(sum == 110);
+}
@@ -0,0 +1,134 @@
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "catch.hpp"
+#include "../eventus.hpp"
+
+using namespace eventus;
+using namespace std;
+
+TEST_CASE("concurrent_event_queue", "[concurrent]") {
+    SECTION("one event, two handlers") {
+        concurrent_event_queue<string> eq;
+        auto calls = 0;
+        eq.add_handler<int>("test0", [&](int i) {
+            REQUIRE(i == 4);
+            ++calls;
+        });
+        eq.add_handler<const int&>("test0", [&](const int& i) {
+            REQUIRE(i == 4);
+            ++calls;
+        });
+        eq.fire("test0", 4);
+        REQUIRE(calls == 2);
+    }
+
+    SECTION("calls higher priorities first") {
+        concurrent_event_queue<int> eq;
+        auto calls = vector<int>();
+        eq.add_handler<int>(0, [&](int) { calls.push_back(2); });
+        eq.add_handler<int>(0, [&](int) { calls.push_back(3); }, -1);
+        eq.add_handler<int>(0, [&](int) { calls.push_back(1); }, 1);
+        eq.fire(0, 0);
+        REQUIRE(calls == vector<int>{ 1, 2, 3 });
+    }
+
+    SECTION("removes a handler") {
+        concurrent_event_queue<string> eq;
+        auto handler0 = eq.add_handler("test0", []() {
+            REQUIRE(false);
+        });
+        auto copy = handler0;
+        REQUIRE_FALSE(copy.removed());
+        eq.remove_handler(handler0);
+        REQUIRE(copy.removed());
+        eq.fire("test0");
+        typedef handler_info<string, void>::handler_removed handler_removed;
+        REQUIRE_THROWS_AS(eq.remove_handler(handler0), handler_removed);
+        REQUIRE_THROWS_AS(eq.remove_handler(copy), handler_removed);
+    }
+
+    SECTION("throws on different types") {
+        concurrent_event_queue<string> eq;
+        eq.add_handler<string>("test0", [](string) { return; });
+        REQUIRE_THROWS_AS(eq.fire("test0", 3), bad_cast);
+        REQUIRE_THROWS_AS(eq.fire("test0"), invalid_argument);
+        REQUIRE_THROWS_AS(eq.add_handler<int>("test0", [](int) { return; }), bad_cast);
+    }
+
+    SECTION("handlers can add and remove handlers") {
+        concurrent_event_queue<int> eq;
+        auto calls = 0;
+        handler_info<int, int>* ptr_handler0;
+        auto handler0 = eq.add_handler<int>(0, [&](int) {
+            ++calls;
+            eq.remove_handler(*ptr_handler0);
+            eq.add_handler<int>(0, [&](int) { ++calls; });
+        });
+        ptr_handler0 = &handler0;
+        eq.fire(0, 1);
+        REQUIRE(calls == 1);
+        eq.fire(0, 1);
+        REQUIRE(calls == 2);
+    }
+
+    SECTION("fires from many threads while handlers change") {
+        const int THREADS = 8;
+        const int FIRES = 20000;
+
+        concurrent_event_queue<int> eq;
+        atomic<int> calls(0);
+        atomic<bool> done(false);
+        eq.add_handler<int>(0, [&](int i) { calls += i; });
+
+        auto churn = thread([&]() {
+            auto event = 1;
+            while (!done.load()) {
+                auto h = eq.add_handler<int>(0, [](int) { return; });
+                eq.add_handler<int>(event++ % 100 + 1, [](int) { return; });
+                eq.remove_handler(h);
+            }
+        });
+
+        auto firing = vector<thread>();
+        for (auto t = 0; t < THREADS; ++t) {
+            firing.emplace_back([&]() {
+                for (auto i = 0; i < FIRES; ++i)
+                    eq.fire(0, 1);
+            });
+        }
+        for (auto& t : firing)
+            t.join();
+        done.store(true);
+        churn.join();
+
+        REQUIRE(calls.load() == THREADS * FIRES);
+    }
+
+    SECTION("handlers change handlers from many threads") {
+        const int THREADS = 8;
+        const int FIRES = 2000;
+
+        concurrent_event_queue<int> eq;
+        atomic<int> calls(0);
+        eq.add_handler<int>(0, [&](int t) {
+            ++calls;
+            auto h = eq.add_handler(t + 1, []() { return; });
+            eq.fire(t + 1);
+            eq.remove_handler(h);
+        });
+
+        auto firing = vector<thread>();
+        for (auto t = 0; t < THREADS; ++t) {
+            firing.emplace_back([&eq, t]() {
+                for (auto i = 0; i < FIRES; ++i)
+                    eq.fire(0, int(t));
+            });
+        }
+        for (auto& t : firing)
+            t.join();
+
+        REQUIRE(calls.load() == THREADS * FIRES);
+    }
+}
@@ -0,0 +1,130 @@
+#include <string>
+#include <vector>
+#include "catch.hpp"
+#include "../eventus.hpp"
+
+using namespace eventus;
+using namespace std;
+
+TEST_CASE("deferred events", "[deferred]") {
+    SECTION("doesn't fire until dispatched") {
+        auto eq = event_queue<string>();
+        auto calls = 0;
+        eq.add_handler<int>("event0", [&](int i) {
+            REQUIRE(i == 3);
+            ++calls;
+        });
+        eq.enqueue("event0", 3);
+        REQUIRE(calls == 0);
+        REQUIRE(eq.queued() == 1);
+
+        REQUIRE(eq.dispatch() == 1);
+        REQUIRE(calls == 1);
+        REQUIRE(eq.queued() == 0);
+    }
+
+    SECTION("fires in the order events were queued") {
+        auto eq = event_queue<string>();
+        auto order = vector<string>();
+        eq.add_handler<int>("event0", [&](int i) { order.push_back("event0:" + to_string(i)); });
+        eq.add_handler<string>("event1", [&](const string& s) { order.push_back("event1:" + s); });
+        eq.add_handler("event2", [&]() { order.push_back("event2"); });
+
+        eq.enqueue("event0", 1);
+        eq.enqueue("event1", string("a"));
+        eq.enqueue("event0", 2);
+        eq.enqueue("event0", 3);
+        eq.enqueue("event2");
+        eq.enqueue("event1", string("b"));
+        eq.dispatch();
+
+        REQUIRE(order == (vector<string> {
+            "event0:1", "event1:a", "event0:2", "event0:3", "event2", "event1:b"
+        }));
+    }
+
+    SECTION("keeps parameters intact while growing") {
+        auto eq = event_queue<int>();
+        auto received = vector<string>();
+        eq.add_handler<string>(0, [&](const string& s) { received.push_back(s); });
+
+        auto expected = vector<string>();
+        for (auto i = 0; i < 1000; ++i) {
+            // long enough to not fit in the small string buffer
+            expected.push_back("a reasonably long parameter number " + to_string(i));
+            eq.enqueue(0, expected.back());
+        }
+        REQUIRE(eq.dispatch() == 1000);
+        REQUIRE(received == expected);
+    }
+
+    SECTION("drain fires at most max events") {
+        auto eq = event_queue<int>();
+        auto received = vector<int>();
+        eq.add_handler<int>(0, [&](int i) { received.push_back(i); });
+        for (auto i = 0; i < 5; ++i)
+            eq.enqueue(0, int(i));
+
+        REQUIRE(eq.drain(2) == 2);
+        REQUIRE(received == (vector<int> { 0, 1 }));
+        REQUIRE(eq.queued() == 3);
+
+        eq.enqueue(0, 5);
+        REQUIRE(eq.drain(10) == 4);
+        REQUIRE(received == (vector<int> { 0, 1, 2, 3, 4, 5 }));
+    }
+
+    SECTION("events queued by handlers wait for the next dispatch") {
+        auto eq = event_queue<int>();
+        auto received = vector<int>();
+        eq.add_handler<int>(0, [&](int i) {
+            received.push_back(i);
+            if (i < 3)
+                eq.enqueue(0, i + 1);
+        });
+        eq.enqueue(0, 0);
+
+        REQUIRE(eq.dispatch() == 1);
+        REQUIRE(eq.dispatch() == 1);
+        REQUIRE(received == (vector<int> { 0, 1 }));
+        REQUIRE(eq.queued() == 1);
+    }
+
+    SECTION("skips events without handlers") {
+        auto eq = event_queue<int>();
+        auto calls = 0;
+        eq.add_handler<int>(1, [&](int) { ++calls; });
+        eq.enqueue(0, 1);
+        eq.enqueue(1, 1);
+        REQUIRE(eq.dispatch() == 2);
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("keeps the remaining events when a handler throws") {
+        auto eq = event_queue<int>();
+        auto received = vector<int>();
+        eq.add_handler<int>(0, [&](int i) {
+            if (i == 1)
+                throw runtime_error("test");
+            received.push_back(i);
+        });
+        eq.enqueue(0, 0);
+        eq.enqueue(0, 1);
+        eq.enqueue(0, 2);
+
+        REQUIRE_THROWS_AS(eq.dispatch(), runtime_error);
+        REQUIRE(eq.queued() == 1);
+        eq.dispatch();
+        REQUIRE(received == (vector<int> { 0, 2 }));
+    }
+
+    SECTION("throws on different types when dispatched") {
+        auto eq = event_queue<string>();
+        eq.add_handler<string>("event0", [](string) { return; });
+        eq.add_handler("event1", []() { return; });
+        eq.enqueue("event0", 3);
+        eq.enqueue("event1", 3);
+        REQUIRE_THROWS_AS(eq.dispatch(), bad_cast);
+        REQUIRE_THROWS_AS(eq.dispatch(), invalid_argument);
+    }
+}
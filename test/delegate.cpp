@@ -0,0 +1,77 @@
+#include <array>
+#include <memory>
+#include <string>
+#include "catch.hpp"
+#include "../eventus.hpp"
+
+using namespace _eventus_util;
+using namespace std;
+
+TEST_CASE("delegate", "[delegate]") {
+    SECTION("calls a small lambda") {
+        auto calls = 0;
+        auto d = delegate<void(int)>([&](int i) { calls += i; });
+        d(3);
+        REQUIRE(calls == 3);
+    }
+
+    SECTION("calls a lambda larger than the inline buffer") {
+        array<int, 64> values;
+        values.fill(2);
+        auto result = 0;
+        auto d = delegate<void(int)>([values, &result](int i) { result = values[i]; });
+        d(5);
+        REQUIRE(result == 2);
+    }
+
+    SECTION("returns the result") {
+        auto d = delegate<int(int, int)>([](int a, int b) { return a + b; });
+        REQUIRE(d(2, 3) == 5);
+    }
+
+    SECTION("is empty by default and after reset") {
+        auto d = delegate<void()>();
+        REQUIRE_FALSE(d);
+        d = delegate<void()>([]() { return; });
+        REQUIRE(d);
+        d.reset();
+        REQUIRE_FALSE(d);
+    }
+
+    SECTION("moves the callable") {
+        auto counter = make_shared<int>(0);
+        auto d0 = delegate<void()>([counter]() { ++*counter; });
+        REQUIRE(counter.use_count() == 2);
+
+        auto d1 = move(d0);
+        REQUIRE_FALSE(d0);
+        REQUIRE(counter.use_count() == 2);
+        d1();
+        REQUIRE(*counter == 1);
+
+        d1.reset();
+        REQUIRE(counter.use_count() == 1);
+    }
+
+    SECTION("destroys a heap allocated callable") {
+        auto counter = make_shared<int>(0);
+        array<int, 64> padding;
+        padding.fill(0);
+        {
+            auto d = delegate<void()>([counter, padding]() { ++*counter; });
+            auto moved = move(d);
+            REQUIRE(counter.use_count() == 2);
+        }
+        REQUIRE(counter.use_count() == 1);
+    }
+
+    SECTION("takes move-only callables") {
+        auto p = unique_ptr<string>(new string("test"));
+        struct holder {
+            unique_ptr<string> s;
+            size_t operator()() const { return s->size(); }
+        };
+        auto d = delegate<size_t()>(holder{move(p)});
+        REQUIRE(d() == 4);
+    }
+}
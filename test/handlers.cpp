@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <vector>
 #include "catch.hpp"
 #include "../eventus.hpp"
 
@@ -24,3 +26,66 @@ TEST_CASE("handlers") {
         REQUIRE_THROWS_AS(eq.add_handler<int>(8, [](int) { return; }), std::invalid_argument);
     }
 }
+
+TEST_CASE("handler tables stay bounded however handlers churn", "[handlers]") {
+    handler_table<void> table(*default_resource());
+    auto fire = [&table] {
+        dispatch<void>(table, [](const delegate_t<void>& h, const void*) { return h(); }, nullptr);
+    };
+
+    // The live handlers, oldest first
+    std::vector<slot_ref*> live;
+    auto replace_oldest = [&] {
+        live.push_back(&table.add([] {}, 0));
+        table.remove(*live.front());
+        live.erase(live.begin());
+    };
+
+    const size_t LIVE = 8;
+    for (size_t i = 0; i < LIVE; ++i)
+        live.push_back(&table.add([] {}, 0));
+    // Replaces a handler from inside each fire, while the table is pinned
+    table.add(replace_oldest, 1);
+
+    size_t max_slots = 0;
+    size_t max_tombstones = 0;
+    for (auto i = 0; i < 10000; ++i) {
+        fire();
+        REQUIRE(table.pending.empty());
+        max_slots = std::max(max_slots, table.slots.size());
+        max_tombstones = std::max(max_tombstones, table.tombstones);
+
+        replace_oldest();
+        max_slots = std::max(max_slots, table.slots.size());
+        max_tombstones = std::max(max_tombstones, table.tombstones);
+    }
+
+    // Tombstones are erased once they make up half of the slots, so there are never more than the live handlers
+    REQUIRE(live.size() == LIVE);
+    REQUIRE(max_slots <= 2 * (LIVE + 1));
+    REQUIRE(max_tombstones <= LIVE + 1);
+}
+
+TEST_CASE("handlers removed while firing wait for the tombstones to be erased", "[handlers]") {
+    handler_table<void> table(*default_resource());
+    auto fire = [&table] {
+        dispatch<void>(table, [](const delegate_t<void>& h, const void*) { return h(); }, nullptr);
+    };
+
+    std::vector<slot_ref*> refs;
+    for (auto i = 0; i < 10; ++i)
+        refs.push_back(&table.add([] {}, 0));
+    auto removed = false;
+    table.add([&] {
+        if (!removed)
+            table.remove(*refs[0]);
+        removed = true;
+    }, 1);
+
+    // The fire doesn't erase the one tombstone it leaves, but the removed handler is destroyed
+    fire();
+    REQUIRE(table.slots.size() == 11);
+    REQUIRE(table.tombstones == 1);
+    REQUIRE_FALSE(table.slots[1].fn);
+    REQUIRE(table.removed_pinned.empty());
+}
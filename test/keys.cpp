@@ -1,3 +1,4 @@
+#include <stdexcept>
 #include <string>
 #include "catch.hpp"
 #include "../eventus.hpp"
@@ -5,6 +6,18 @@
 using namespace eventus;
 using namespace std;
 
+namespace {
+    enum class dense_key : unsigned { MOVED, RESIZED, CLOSED, COUNT };
+    enum plain_dense_key { OPENED, SHOWN, HIDDEN, PLAIN_COUNT };
+}
+
+namespace eventus {
+    template<> struct event_key_bound<dense_key> :
+        integral_constant<size_t, static_cast<size_t>(dense_key::COUNT)> {};
+    template<> struct event_key_bound<plain_dense_key> : integral_constant<size_t, PLAIN_COUNT> {};
+    template<> struct event_key_bound<unsigned char> : integral_constant<size_t, 16> {};
+}
+
 TEST_CASE("works with different key types", "[keys]") {
     SECTION("std::string") {
         auto eq = event_queue<string>();
@@ -62,5 +75,104 @@ TEST_CASE("works with different key types", "[keys]") {
         eq.fire(a::C, 4);
     }
     //*/
-}
 
+    SECTION("dense scoped enum") {
+        auto eq = event_queue<dense_key>();
+        auto calls = 0;
+        auto handler0 = eq.add_handler<int>(dense_key::MOVED, [&](int i) { calls += i; });
+        eq.add_handler(dense_key::CLOSED, [&]() { calls += 100; });
+
+        eq.fire(dense_key::MOVED, 3);
+        eq.fire(dense_key::RESIZED, 4);
+        eq.fire(dense_key::CLOSED);
+        REQUIRE(calls == 103);
+
+        eq.remove_handler(handler0);
+        eq.fire(dense_key::MOVED, 3);
+        REQUIRE(calls == 103);
+        REQUIRE_THROWS_AS(eq.add_handler(dense_key::COUNT, []() { return; }), out_of_range);
+    }
+
+    SECTION("dense classic enum") {
+        auto eq = event_queue<plain_dense_key>();
+        eq.add_handler<int>(SHOWN, [](int i) {
+            REQUIRE(i == 3);
+        });
+        eq.fire(SHOWN, 3);
+        REQUIRE_THROWS_AS(eq.fire(SHOWN), invalid_argument);
+    }
+
+    SECTION("dense integral") {
+        auto eq = event_queue<unsigned char>();
+        auto calls = 0;
+        eq.add_handler<int>(15, [&](int i) { calls += i; });
+        eq.fire(15, 3);
+        eq.fire(200, 3);
+        REQUIRE(calls == 3);
+        REQUIRE_THROWS_AS(eq.add_handler<int>(16, [](int) { return; }), out_of_range);
+    }
+
+    SECTION("dense queue can be moved") {
+        auto eq = event_queue<dense_key>();
+        auto calls = 0;
+        auto ch = eq.channel<int>(dense_key::RESIZED);
+        auto handler0 = eq.add_handler<int>(dense_key::RESIZED, [&](int i) { calls += i; });
+
+        auto moved = move(eq);
+        moved.fire(dense_key::RESIZED, 3);
+        ch.fire(4);
+        moved.remove_handler(handler0);
+        moved.fire(dense_key::RESIZED, 3);
+        REQUIRE(calls == 7);
+
+        auto assigned = event_queue<dense_key>();
+        assigned.add_handler(dense_key::CLOSED, [&]() { calls += 100; });
+        auto handler1 = moved.add_handler<int>(dense_key::RESIZED, [&](int i) { calls += i; });
+        assigned = move(moved);
+        assigned.fire(dense_key::RESIZED, 5);
+        assigned.fire(dense_key::CLOSED);
+        assigned.remove_handler(handler1);
+        assigned.fire(dense_key::RESIZED, 5);
+        REQUIRE(calls == 12);
+    }
+
+    SECTION("std::string events looked up by other string types") {
+        auto eq = event_queue<string>();
+        auto calls = 0;
+        const char* name = "market.data.equities.level2.snapshot.updated";
+        const string topic = name;
+        auto handler0 = eq.add_handler<int>(name, [&](int i) { calls += i; });
+        eq.add_handler(topic + ".closed", [&]() { calls += 100; });
+        REQUIRE(handler0.event() == topic);
+
+        eq.fire(name, 1);
+        eq.fire(topic, 2);
+        eq.fire(string(name), 3);
+        eq.fire("market.data.equities.level2.snapshot.updated", 4);
+        REQUIRE(calls == 10);
+        REQUIRE_THROWS_AS(eq.fire(name), invalid_argument);
+
+        eq.fire("market.data.equities.level2.snapshot.updated.closed");
+        REQUIRE(calls == 110);
+        calls = 10;
+
+        eq.fire("unknown", 5);
+        REQUIRE(calls == 10);
+#if __cplusplus >= 201703L
+        eq.fire(string_view(topic), 5);
+        REQUIRE(calls == 15);
+#endif
+    }
+
+    SECTION("std::string events with many keys") {
+        auto eq = event_queue<string>();
+        auto total = 0;
+        for (auto i = 0; i < 1000; ++i)
+            eq.add_handler<int>("event" + to_string(i), [&total, i](int x) { total += i * x; });
+        for (auto i = 0; i < 1000; ++i) {
+            total = 0;
+            eq.fire("event" + to_string(i), 2);
+            REQUIRE(total == 2 * i);
+        }
+    }
+}
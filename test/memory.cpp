@@ -0,0 +1,191 @@
+#include <cstddef>
+#include <string>
+#include "catch.hpp"
+#include "../eventus.hpp"
+
+using namespace eventus;
+using namespace std;
+
+namespace {
+    // Allocates from the default resource, keeping count of what is still allocated.
+    class counting_resource : public memory_resource {
+    public:
+        long allocations = 0;
+        long outstanding = 0;
+        // Makes every allocation throw, like a resource which has run out of memory
+        bool exhausted = false;
+
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override {
+            if (exhausted)
+                throw bad_alloc();
+            ++allocations;
+            outstanding += static_cast<long>(bytes);
+            return default_resource()->allocate(bytes, alignment);
+        }
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+            outstanding -= static_cast<long>(bytes);
+            default_resource()->deallocate(p, bytes, alignment);
+        }
+        bool do_is_equal(const memory_resource& other) const noexcept override { return this == &other; }
+    };
+
+    // Hands out a fixed buffer and never frees anything, like std::pmr::monotonic_buffer_resource.
+    class arena_resource : public memory_resource {
+    public:
+        size_t used = 0;
+
+    private:
+        alignas(alignof(max_align_t)) char _buffer[64 * 1024];
+
+        void* do_allocate(size_t bytes, size_t alignment) override {
+            auto start = (used + alignment - 1) / alignment * alignment;
+            if (start + bytes > sizeof(_buffer))
+                throw bad_alloc();
+            used = start + bytes;
+            return _buffer + start;
+        }
+        void do_deallocate(void*, size_t, size_t) override {}
+        bool do_is_equal(const memory_resource& other) const noexcept override { return this == &other; }
+    };
+
+    enum class dense_key : unsigned { A, B, COUNT };
+
+    struct moved { using payload = int; };
+    struct closed { using payload = void; };
+}
+
+namespace eventus {
+    template<> struct event_key_bound<dense_key> : integral_constant<size_t, static_cast<size_t>(dense_key::COUNT)> {};
+}
+
+TEST_CASE("memory resources", "[memory]") {
+    SECTION("an event_queue allocates from its resource and gives everything back") {
+        counting_resource resource;
+        auto calls = 0;
+        {
+            auto eq = event_queue<int>(resource);
+            string a = "a", b = "b", c = "c", d = "d";
+            for (auto i = 0; i < 100; ++i)
+                eq.add_handler<int>(int(i), [&calls](int) { ++calls; });
+            auto large = eq.add_handler<int>(0, [&calls, a, b, c, d](int) { ++calls; });
+            eq.add_handler<int, int>(1000, [&calls](int, int) { ++calls; });
+
+            for (auto i = 0; i < 100; ++i)
+                eq.fire(int(i), i);
+            eq.enqueue(0, 0);
+            eq.enqueue(1000, 1, 2);
+            eq.dispatch();
+            eq.remove_handler(large);
+            eq.fire(0, 0);
+            REQUIRE(resource.allocations > 0);
+        }
+        REQUIRE(calls == 100 + 1 + 2 + 1 + 1);
+        REQUIRE(resource.outstanding == 0);
+    }
+
+    SECTION("move assigning an event_queue frees its storage, and takes the other's with its resource") {
+        counting_resource first, second;
+        auto calls = 0;
+        {
+            auto a = event_queue<int>(first);
+            auto b = event_queue<int>(second);
+            a.add_handler<int>(0, [&calls](int) { calls += 100; });
+            a.enqueue(0, 1);
+            b.add_handler<int>(0, [&calls](int i) { calls += i; });
+            b.enqueue(0, 1);
+
+            a = move(b);
+            REQUIRE(first.outstanding == 0);
+            a.fire(0, 2);
+            a.enqueue(0, 3);
+            a.dispatch();
+            REQUIRE(second.outstanding > 0);
+        }
+        REQUIRE(calls == 1 + 2 + 3);
+        REQUIRE(first.outstanding == 0);
+        REQUIRE(second.outstanding == 0);
+    }
+
+    SECTION("draining part of a queue which never empties doesn't grow its storage") {
+        counting_resource resource;
+        auto eq = event_queue<int>(resource);
+        auto sum = 0;
+        eq.add_handler<int>(0, [&sum](int i) { sum += i; });
+        for (auto i = 0; i < 10; ++i)
+            eq.enqueue(0, 1);
+
+        auto run = [&](int ticks) {
+            for (auto i = 0; i < ticks; ++i) {
+                eq.enqueue(0, 1);
+                eq.drain(1);
+            }
+        };
+        run(100);
+        auto outstanding = resource.outstanding;
+        run(10000);
+        REQUIRE(resource.outstanding == outstanding);
+        REQUIRE(sum == 10100);
+    }
+
+    SECTION("handlers added while firing stay pending if merging them runs out of memory") {
+        counting_resource resource;
+        auto eq = event_queue<int>(resource);
+        auto calls = 0;
+        auto added = false;
+        eq.add_handler<int>(0, [&calls](int) { ++calls; });
+        eq.add_handler<int>(0, [&](int) {
+            if (added)
+                return;
+            added = true;
+            eq.add_handler<int>(0, [&calls](int) { calls += 10; });
+            resource.exhausted = true;
+        });
+
+        eq.fire(0, 0);
+        REQUIRE(calls == 1);
+        resource.exhausted = false;
+        eq.fire(0, 0);
+        REQUIRE(calls == 1 + 11);
+    }
+
+    SECTION("a whole queue fits in an arena") {
+        arena_resource arena;
+        auto calls = 0;
+        {
+            auto eq = event_queue<dense_key>(arena);
+            eq.add_handler<int>(dense_key::A, [&calls](int i) { calls += i; });
+            eq.add_handler(dense_key::B, [&calls]() { ++calls; });
+            eq.fire(dense_key::A, 2);
+            eq.fire(dense_key::B);
+            REQUIRE(arena.used > 0);
+        }
+        REQUIRE(calls == 3);
+    }
+
+    SECTION("a static_event_queue allocates its handlers from its resource") {
+        counting_resource resource;
+        auto calls = 0;
+        {
+            auto eq = static_event_queue<moved, closed>(resource);
+            eq.add_handler<moved>([&calls](int i) { calls += i; });
+            eq.add_handler<closed>([&calls]() { ++calls; });
+            eq.fire<moved>(2);
+            eq.fire<closed>();
+            REQUIRE(resource.allocations > 0);
+        }
+        REQUIRE(calls == 3);
+        REQUIRE(resource.outstanding == 0);
+    }
+
+#ifdef EVENTUS_STD_MEMORY_RESOURCE
+    SECTION("works with std::pmr resources") {
+        std::pmr::monotonic_buffer_resource arena;
+        auto calls = 0;
+        auto eq = event_queue<string>(arena);
+        eq.add_handler<int>("test0", [&calls](int i) { calls += i; });
+        eq.fire("test0", 3);
+        REQUIRE(calls == 3);
+    }
+#endif
+}
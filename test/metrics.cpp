@@ -0,0 +1,174 @@
+#define CATCH_CONFIG_MAIN
+#define EVENTUS_METRICS
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "catch.hpp"
+#include "../eventus.hpp"
+
+using namespace eventus;
+using namespace std;
+
+// EVENTUS_METRICS changes the layout of the handler tables, so these tests are built as their own executable.
+
+namespace {
+    enum class window_event : unsigned { MOVED, RESIZED, CLOSED, COUNT };
+
+    template<typename event_type>
+    const event_metrics<event_type>* find(const vector<event_metrics<event_type>>& metrics, const event_type& event) {
+        for (const auto& m : metrics) {
+            if (m.event == event)
+                return &m;
+        }
+        return nullptr;
+    }
+}
+
+namespace eventus {
+    template<> struct event_key_bound<window_event> :
+        integral_constant<size_t, static_cast<size_t>(window_event::COUNT)> {};
+}
+
+TEST_CASE("latency histogram", "[metrics]") {
+    SECTION("buckets") {
+        for (uint64_t ns = 0; ns < 4; ++ns)
+            REQUIRE(latency_histogram::bucket(ns) == ns);
+        REQUIRE(latency_histogram::bucket(4) == 4);
+        REQUIRE(latency_histogram::bucket(7) == 7);
+        REQUIRE(latency_histogram::bucket(8) == 8);
+        REQUIRE(latency_histogram::bucket(9) == 8);
+        REQUIRE(latency_histogram::bucket(10) == 9);
+        REQUIRE(latency_histogram::bucket(~uint64_t(0)) == latency_histogram::size() - 1);
+
+        for (size_t i = 0; i < latency_histogram::size(); ++i) {
+            auto lower = latency_histogram::lower_bound(i);
+            REQUIRE(latency_histogram::bucket(lower) == i);
+            if (i > 0)
+                REQUIRE(latency_histogram::bucket(lower - 1) == i - 1);
+        }
+    }
+
+    SECTION("counts and percentiles") {
+        auto h = latency_histogram();
+        REQUIRE(h.percentile(50) == 0);
+
+        for (uint64_t ns = 1; ns <= 100; ++ns)
+            h.record(ns * 1000);
+        REQUIRE(h.count() == 100);
+        REQUIRE(h.total() == 5050 * 1000);
+        REQUIRE(h.max() == 100000);
+
+        // Within the 25% width of a bucket
+        REQUIRE(h.percentile(50) >= 50000);
+        REQUIRE(h.percentile(50) < 50000 * 5 / 4);
+        REQUIRE(h.percentile(99) >= 99000);
+        REQUIRE(h.percentile(100) == 100000);
+
+        h.reset();
+        REQUIRE(h.count() == 0);
+        REQUIRE(h.max() == 0);
+    }
+}
+
+TEST_CASE("event queue metrics", "[metrics]") {
+    auto eq = event_queue<string>();
+    auto sum = 0;
+    auto fast = eq.add_handler<int>("moved", [&sum](int i) { sum += i; });
+    auto slow = eq.add_handler<int>("moved", [&sum](int i) {
+        this_thread::sleep_for(chrono::milliseconds(2));
+        sum += i;
+    }, -1);
+    eq.add_handler("closed", [&sum]() { ++sum; });
+    eq.add_handler("closed", []() { return true; }, 1);
+
+    eq.fire("moved", 1);
+    eq.channel<int>("moved").fire(1);
+    eq.enqueue("moved", 1);
+    eq.dispatch();
+    eq.fire("closed");
+    eq.fire("unknown", 1);
+
+    SECTION("counts the fires of each event and the handlers they call") {
+        auto metrics = eq.metrics();
+        REQUIRE(metrics.size() == 2);
+        REQUIRE(find<string>(metrics, "unknown") == nullptr);
+
+        auto moved = find<string>(metrics, "moved");
+        REQUIRE(moved != nullptr);
+        REQUIRE(moved->fires == 3);
+        REQUIRE(moved->handlers_invoked == 6);
+        REQUIRE(moved->handlers.size() == 2);
+        REQUIRE(moved->handlers[0].priority == 0);
+        REQUIRE(moved->handlers[0].latency.count() == 3);
+        REQUIRE(moved->handlers[1].priority == -1);
+        REQUIRE(moved->handlers[1].latency.count() == 3);
+
+        // The handler returning true stops the other one
+        auto closed = find<string>(metrics, "closed");
+        REQUIRE(closed != nullptr);
+        REQUIRE(closed->fires == 1);
+        REQUIRE(closed->handlers_invoked == 1);
+        REQUIRE(closed->handlers[0].latency.count() == 1);
+        REQUIRE(closed->handlers[1].latency.count() == 0);
+        REQUIRE(sum == 6);
+    }
+
+    SECTION("times each handler") {
+        auto slow_latency = eq.metrics(slow);
+        REQUIRE(slow_latency.count() == 3);
+        REQUIRE(slow_latency.percentile(50) >= 2000000);
+        REQUIRE(slow_latency.total() >= 6000000);
+        REQUIRE(eq.metrics(fast).max() < slow_latency.max());
+
+        typedef handler_info<string, int>::handler_removed handler_removed;
+        eq.remove_handler(fast);
+        REQUIRE_THROWS_AS(eq.metrics(fast), handler_removed);
+        REQUIRE(eq.metrics(slow).count() == 3);
+    }
+
+    SECTION("times handlers which are still pending, and keeps their times once they are merged") {
+        auto added = vector<handler_info<string, int>>();
+        uint64_t pending_calls = 0;
+        eq.add_handler<int>("late", [&](int depth) {
+            if (depth > 0)
+                return;
+            added.push_back(eq.add_handler<int>("late", [](int) {}));
+            eq.fire("late", 1);
+            pending_calls = eq.metrics(added[0]).count();
+        });
+
+        eq.fire("late", 0);
+        REQUIRE(pending_calls == 1);
+        REQUIRE(eq.metrics(added[0]).count() == 1);
+        eq.fire("late", 1);
+        REQUIRE(eq.metrics(added[0]).count() == 2);
+    }
+
+    SECTION("resets the counters") {
+        eq.reset_metrics();
+        auto metrics = eq.metrics();
+        auto moved = find<string>(metrics, "moved");
+        REQUIRE(moved->fires == 0);
+        REQUIRE(moved->handlers_invoked == 0);
+        REQUIRE(moved->handlers[0].latency.count() == 0);
+        REQUIRE(eq.metrics(slow).count() == 0);
+    }
+}
+
+TEST_CASE("event queue metrics with dense keys", "[metrics]") {
+    auto eq = event_queue<window_event>();
+    eq.add_handler<int>(window_event::RESIZED, [](int) {});
+    eq.add_handler(window_event::MOVED, []() {});
+    for (auto i = 0; i < 5; ++i)
+        eq.fire(window_event::RESIZED, 1);
+
+    auto metrics = eq.metrics();
+    REQUIRE(metrics.size() == 2);
+    REQUIRE(metrics[0].event == window_event::MOVED);
+    REQUIRE(metrics[0].fires == 0);
+    REQUIRE(metrics[1].event == window_event::RESIZED);
+    REQUIRE(metrics[1].fires == 5);
+    REQUIRE(metrics[1].handlers[0].latency.count() == 5);
+}
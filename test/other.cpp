@@ -1,4 +1,5 @@
 #include <string>
+#include <vector>
 #include "catch.hpp"
 #include "../eventus.hpp"
 
@@ -16,4 +17,218 @@ TEST_CASE("add_handler in handler", "[other]") {
         });
         eq.fire("event0", 3);
     }
+
+    SECTION("new handler is called on the next fire") {
+        auto eq = event_queue<string>();
+        auto added = false;
+        auto calls = 0;
+        eq.add_handler<int>("event0", [&](int) {
+            if (added)
+                return;
+            added = true;
+            eq.add_handler<int>("event0", [&](int) { ++calls; });
+        });
+        eq.fire("event0", 3);
+        REQUIRE(calls == 0);
+        eq.fire("event0", 3);
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("many handlers added while firing don't disturb the fire") {
+        auto eq = event_queue<int>();
+        auto calls = 0;
+        auto added = false;
+        eq.add_handler<int>(0, [&](int) {
+            if (added)
+                return;
+            added = true;
+            for (auto i = 0; i < 1000; ++i)
+                eq.add_handler<int>(0, [&](int) { ++calls; });
+        });
+        eq.add_handler<int>(0, [&](int) { ++calls; });
+        eq.fire(0, 0);
+        REQUIRE(calls == 1);
+        eq.fire(0, 0);
+        REQUIRE(calls == 1 + 1001);
+    }
+
+    SECTION("a handler added while firing is called by nested fires which start after it") {
+        const auto depth = 100;
+        auto eq = event_queue<int>();
+        auto calls = 0;
+        eq.add_handler<int>(0, [&](int level) {
+            if (level >= depth)
+                return;
+            eq.add_handler<int>(0, [&](int) { ++calls; });
+            eq.fire(0, level + 1);
+        });
+
+        // The fire at each level calls the handlers added by the levels above it
+        eq.fire(0, 0);
+        REQUIRE(calls == depth * (depth + 1) / 2);
+
+        calls = 0;
+        eq.fire(0, depth);
+        REQUIRE(calls == depth);
+    }
+}
+
+TEST_CASE("handlers with large captures", "[other]") {
+    SECTION("are called and removed like any other handler") {
+        auto eq = event_queue<string>();
+        string a = "a", b = "b", c = "c", d = "d";
+        auto result = string();
+        auto handler0 = eq.add_handler<int>("event0", [&result, a, b, c, d](int) {
+            result = a + b + c + d;
+        });
+        eq.fire("event0", 3);
+        REQUIRE(result == "abcd");
+
+        result.clear();
+        eq.remove_handler(handler0);
+        eq.fire("event0", 3);
+        REQUIRE(result.empty());
+    }
+}
+
+TEST_CASE("handler priorities", "[other]") {
+    SECTION("calls higher priorities first, and equal priorities in the order they were added") {
+        auto eq = event_queue<int>();
+        auto calls = vector<int>();
+        eq.add_handler<int>(0, [&](int) { calls.push_back(3); });
+        eq.add_handler<int>(0, [&](int) { calls.push_back(1); }, 10);
+        eq.add_handler<int>(0, [&](int) { calls.push_back(4); });
+        eq.add_handler<int>(0, [&](int) { calls.push_back(5); }, -1);
+        eq.add_handler<int>(0, [&](int) { calls.push_back(2); }, 10);
+        eq.fire(0, 0);
+        REQUIRE(calls == vector<int>{ 1, 2, 3, 4, 5 });
+    }
+
+    SECTION("removes handlers after others are inserted before them") {
+        auto eq = event_queue<int>();
+        auto calls = vector<int>();
+        auto low = eq.add_handler<int>(0, [&](int) { calls.push_back(2); });
+        auto lowest = eq.add_handler<int>(0, [&](int) { calls.push_back(3); }, -5);
+        auto high = eq.add_handler<int>(0, [&](int) { calls.push_back(1); }, 5);
+        eq.remove_handler(low);
+        eq.fire(0, 0);
+        eq.remove_handler(high);
+        eq.fire(0, 0);
+        eq.remove_handler(lowest);
+        eq.fire(0, 0);
+        REQUIRE(calls == vector<int>{ 1, 3, 3 });
+    }
+
+    SECTION("handlers added while firing take their place on the next fire") {
+        auto eq = event_queue<int>();
+        auto calls = vector<int>();
+        auto added = false;
+        eq.add_handler<int>(0, [&](int) {
+            calls.push_back(2);
+            if (added)
+                return;
+            added = true;
+            eq.add_handler<int>(0, [&](int) { calls.push_back(1); }, 1);
+            eq.add_handler<int>(0, [&](int) { calls.push_back(3); }, -1);
+        });
+        eq.fire(0, 0);
+        REQUIRE(calls == vector<int>{ 2 });
+        calls.clear();
+        eq.fire(0, 0);
+        REQUIRE(calls == vector<int>{ 1, 2, 3 });
+    }
+
+    SECTION("applies to every kind of handler") {
+        auto eq = event_queue<string>();
+        auto calls = vector<int>();
+        eq.add_handler("test0", [&]() { calls.push_back(2); });
+        eq.add_handler("test0", [&]() { calls.push_back(1); }, 1);
+        eq.add_handler<int, int>("test1", [&](int, int) { calls.push_back(4); });
+        eq.add_handler<int, int>("test1", [&](int, int) { calls.push_back(3); }, 1);
+        eq.fire("test0");
+        eq.fire("test1", 0, 0);
+        REQUIRE(calls == vector<int>{ 1, 2, 3, 4 });
+    }
+}
+
+TEST_CASE("handlers returning bool", "[other]") {
+    SECTION("a handler returning true stops the event") {
+        auto eq = event_queue<int>();
+        auto calls = vector<int>();
+        eq.add_handler<int>(0, [&](int) { calls.push_back(1); });
+        eq.add_handler<int>(0, [&](int i) {
+            calls.push_back(2);
+            return i == 1;
+        });
+        eq.add_handler<int>(0, [&](int) { calls.push_back(3); });
+        eq.fire(0, 0);
+        REQUIRE(calls == vector<int>{ 1, 2, 3 });
+        calls.clear();
+        eq.fire(0, 1);
+        REQUIRE(calls == vector<int>{ 1, 2 });
+    }
+
+    SECTION("results of other types are ignored") {
+        auto eq = event_queue<int>();
+        auto sum = 0;
+        auto names = vector<string>();
+        eq.add_handler<int>(0, [&](int i) { return sum += i; });
+        eq.add_handler<int>(0, [&](int i) {
+            names.push_back(to_string(i));
+            return names.back();
+        });
+        eq.add_handler<int>(0, [&](int i) { return sum += i; });
+        eq.fire(0, 2);
+        REQUIRE(sum == 4);
+        REQUIRE(names == vector<string>{ "2" });
+    }
+
+    SECTION("the handler with the highest priority gets the event first") {
+        auto eq = event_queue<string>();
+        auto handled_by = 0;
+        eq.add_handler<int>("click", [&](int) {
+            handled_by = 1;
+            return true;
+        });
+        eq.add_handler<int>("click", [&](int) {
+            handled_by = 2;
+            return true;
+        }, 1);
+        eq.fire("click", 0);
+        REQUIRE(handled_by == 2);
+    }
+
+    SECTION("works with every kind of event") {
+        auto eq = event_queue<int>();
+        auto calls = 0;
+        eq.add_handler(0, [&]() {
+            ++calls;
+            return true;
+        });
+        eq.add_handler(0, [&]() { ++calls; });
+        eq.add_handler<int, int>(1, [&](int, int) {
+            ++calls;
+            return true;
+        });
+        eq.add_handler<int, int>(1, [&](int, int) { ++calls; });
+
+        eq.fire(0);
+        eq.fire(1, 2, 3);
+        eq.channel(0).fire();
+        eq.enqueue(1, 2, 3);
+        eq.dispatch();
+        REQUIRE(calls == 4);
+    }
+
+    SECTION("stops a concurrent_event_queue's event") {
+        concurrent_event_queue<int> eq;
+        auto calls = 0;
+        eq.add_handler<int>(0, [&](int) {
+            ++calls;
+            return true;
+        });
+        eq.add_handler<int>(0, [&](int) { ++calls; });
+        eq.fire(0, 0);
+        REQUIRE(calls == 1);
+    }
 }
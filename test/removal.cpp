@@ -1,4 +1,6 @@
+#include <memory>
 #include <string>
+#include <vector>
 #include "catch.hpp"
 #include "../eventus.hpp"
 
@@ -36,8 +38,6 @@ TEST_CASE("remove_handler test", "[removal]") {
     }
 
     SECTION("second handler is removed by first handler, not called") {
-        INFO("test depends on the ordering of handlers, which isn't necessarily guaranteed");
-
         auto eq = event_queue<string>();
         handler_info<string, int>* ptr_handler1;
         auto handler0 = eq.add_handler<int>("event0", [&](int i) {
@@ -72,4 +72,111 @@ TEST_CASE("remove_handler test", "[removal]") {
         eq.fire("event0", 3);
         eq.fire("event0", 3);
     }
+
+    SECTION("handlers still fire in order after many are added and removed") {
+        auto eq = event_queue<int>();
+        auto calls = vector<int>();
+        auto first = eq.add_handler<int>(0, [&](int) { calls.push_back(0); });
+        for (auto i = 0; i < 1000; ++i) {
+            auto churn = eq.add_handler<int>(0, [](int) { REQUIRE(false); });
+            eq.remove_handler(churn);
+        }
+        auto kept = vector<handler_info<int, int>>();
+        for (auto i = 1; i <= 100; ++i)
+            kept.push_back(eq.add_handler<int>(0, [&calls, i](int) { calls.push_back(i); }));
+        for (auto i = 0; i < 100; i += 2)
+            eq.remove_handler(kept[i]);
+        eq.remove_handler(first);
+
+        eq.fire(0, 0);
+        auto expected = vector<int>();
+        for (auto i = 2; i <= 100; i += 2)
+            expected.push_back(i);
+        REQUIRE(calls == expected);
+    }
+
+    SECTION("a handler removing itself from a nested fire isn't called again") {
+        auto eq = event_queue<int>();
+        auto calls = vector<int>();
+        handler_info<int, int>* ptr_handler;
+        auto handler = eq.add_handler<int>(0, [&](int level) {
+            calls.push_back(level);
+            if (level < 10)
+                eq.fire(0, level + 1);
+            else
+                eq.remove_handler(*ptr_handler);
+        });
+        ptr_handler = &handler;
+        auto after = 0;
+        eq.add_handler<int>(0, [&](int) { ++after; });
+
+        eq.fire(0, 0);
+        REQUIRE(calls == vector<int>{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 });
+        REQUIRE(after == 11);
+        REQUIRE(handler.removed());
+
+        eq.fire(0, 0);
+        REQUIRE(calls.size() == 11);
+        REQUIRE(after == 12);
+    }
+
+    SECTION("a handler removed while firing is destroyed once the fire returns") {
+        auto eq = event_queue<int>();
+        auto resource = make_shared<int>(0);
+        handler_info<int, int>* ptr_handler1;
+        eq.add_handler<int>(0, [&](int) { eq.remove_handler(*ptr_handler1); });
+        for (auto i = 0; i < 10; ++i)
+            eq.add_handler<int>(0, [](int) { return; });
+        auto handler1 = eq.add_handler<int>(0, [resource](int) { return; });
+        ptr_handler1 = &handler1;
+        REQUIRE(resource.use_count() == 2);
+
+        eq.fire(0, 0);
+        REQUIRE(resource.use_count() == 1);
+    }
+
+    SECTION("every copy of a handler_info sees the removal") {
+        auto eq = event_queue<string>();
+        auto handler0 = eq.add_handler<int>("event0", [](int) { return; });
+        auto copy = handler0;
+        REQUIRE_FALSE(handler0.removed());
+        REQUIRE_FALSE(copy.removed());
+
+        eq.remove_handler(copy);
+        REQUIRE(handler0.removed());
+        REQUIRE(copy.removed());
+
+        typedef handler_info<string, int>::handler_removed handler_removed;
+        REQUIRE_THROWS_AS(eq.remove_handler(handler0), handler_removed);
+    }
+
+    SECTION("a stale handler_info doesn't remove the handler which reused its slot") {
+        auto eq = event_queue<string>();
+        auto calls = 0;
+        auto handler0 = eq.add_handler<int>("event0", [](int) { REQUIRE(false); });
+        auto stale = handler0;
+        eq.remove_handler(handler0);
+
+        auto handler1 = eq.add_handler<int>("event0", [&](int) { ++calls; });
+        REQUIRE(stale.removed());
+        REQUIRE_FALSE(handler1.removed());
+
+        typedef handler_info<string, int>::handler_removed handler_removed;
+        REQUIRE_THROWS_AS(eq.remove_handler(stale), handler_removed);
+        eq.fire("event0", 3);
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("a handler added and removed while firing is never called") {
+        auto eq = event_queue<string>();
+        auto added = vector<handler_info<string, int>>();
+        eq.add_handler<int>("event0", [&](int) {
+            added.push_back(eq.add_handler<int>("event0", [](int) { REQUIRE(false); }));
+            eq.remove_handler(added.back());
+            REQUIRE(added.back().removed());
+        });
+        eq.fire("event0", 3);
+        eq.fire("event0", 3);
+        REQUIRE(added.size() == 2);
+    }
 }
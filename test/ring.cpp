@@ -0,0 +1,125 @@
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "catch.hpp"
+#include "../eventus.hpp"
+
+using namespace eventus;
+using namespace std;
+
+TEST_CASE("event_ring", "[ring]") {
+    SECTION("fires posted events when pumped") {
+        auto eq = event_queue<string>();
+        auto received = vector<string>();
+        eq.add_handler<string>("event0", [&](const string& s) { received.push_back(s); });
+        eq.add_handler("event1", [&]() { received.push_back("event1"); });
+
+        event_ring<string> ring(eq, 8);
+        REQUIRE(ring.post("event0", string("a")));
+        REQUIRE(ring.post("event1"));
+        REQUIRE(ring.post("event0", string("a much longer string which doesn't fit in a slot")));
+        REQUIRE(received.empty());
+
+        REQUIRE(ring.pump() == 3);
+        REQUIRE(received == (vector<string> {
+            "a", "event1", "a much longer string which doesn't fit in a slot"
+        }));
+        REQUIRE(ring.pump() == 0);
+    }
+
+    SECTION("rounds the capacity up to a power of two") {
+        auto eq = event_queue<int>();
+        event_ring<int> ring(eq, 5);
+        REQUIRE(ring.capacity() == 8);
+    }
+
+    SECTION("pump fires at most max events") {
+        auto eq = event_queue<int>();
+        auto received = vector<int>();
+        eq.add_handler<int>(0, [&](int i) { received.push_back(i); });
+
+        event_ring<int> ring(eq, 8);
+        for (auto i = 0; i < 5; ++i)
+            ring.post(0, int(i));
+        REQUIRE(ring.pump(2) == 2);
+        REQUIRE(ring.pump(10) == 3);
+        REQUIRE(received == (vector<int> { 0, 1, 2, 3, 4 }));
+    }
+
+    SECTION("drop_newest discards events posted while full") {
+        auto eq = event_queue<int>();
+        auto received = vector<int>();
+        eq.add_handler<int>(0, [&](int i) { received.push_back(i); });
+
+        event_ring<int> ring(eq, 4, overflow_policy::drop_newest);
+        for (auto i = 0; i < 4; ++i)
+            REQUIRE(ring.post(0, int(i)));
+        REQUIRE_FALSE(ring.post(0, 4));
+        ring.pump();
+        REQUIRE(received == (vector<int> { 0, 1, 2, 3 }));
+    }
+
+    SECTION("drop_oldest discards the oldest events while full") {
+        auto eq = event_queue<int>();
+        auto received = vector<int>();
+        eq.add_handler<int>(0, [&](int i) { received.push_back(i); });
+
+        event_ring<int> ring(eq, 4, overflow_policy::drop_oldest);
+        for (auto i = 0; i < 6; ++i)
+            REQUIRE(ring.post(0, int(i)));
+        ring.pump();
+        REQUIRE(received == (vector<int> { 2, 3, 4, 5 }));
+    }
+
+    SECTION("keeps the remaining events when a handler throws") {
+        auto eq = event_queue<int>();
+        auto received = vector<int>();
+        eq.add_handler<int>(0, [&](int i) {
+            if (i == 1)
+                throw runtime_error("test");
+            received.push_back(i);
+        });
+
+        event_ring<int> ring(eq, 4);
+        for (auto i = 0; i < 3; ++i)
+            ring.post(0, int(i));
+        REQUIRE_THROWS_AS(ring.pump(), runtime_error);
+        ring.pump();
+        REQUIRE(received == (vector<int> { 0, 2 }));
+    }
+
+    SECTION("many producers, one consumer") {
+        const int THREADS = 8;
+        const int POSTS = 10000;
+
+        auto eq = event_queue<int>();
+        auto last = vector<int>(THREADS, -1);
+        auto in_order = true;
+        auto received = 0;
+        eq.add_handler<int>(0, [&](int i) {
+            auto producer = i / POSTS;
+            in_order = in_order && i % POSTS == last[producer] + 1;
+            last[producer] = i % POSTS;
+            ++received;
+        });
+
+        event_ring<int> ring(eq, 256, overflow_policy::block);
+        auto producers = vector<thread>();
+        for (auto t = 0; t < THREADS; ++t) {
+            producers.emplace_back([&ring, t]() {
+                for (auto i = 0; i < POSTS; ++i)
+                    ring.post(0, t * POSTS + i);
+            });
+        }
+        while (received < THREADS * POSTS) {
+            if (ring.pump() == 0)
+                this_thread::yield();
+        }
+        for (auto& t : producers)
+            t.join();
+
+        REQUIRE(received == THREADS * POSTS);
+        REQUIRE(in_order);
+    }
+}
@@ -0,0 +1,94 @@
+#include <string>
+#include <vector>
+#include "catch.hpp"
+#include "../eventus.hpp"
+
+using namespace eventus;
+using namespace std;
+
+namespace {
+    struct point {
+        int x;
+        int y;
+    };
+
+    struct moved { using payload = point; };
+    struct renamed { using payload = string; };
+    struct closed { using payload = void; };
+}
+
+TEST_CASE("static_event_queue", "[static]") {
+    SECTION("fires each event's handlers") {
+        auto eq = static_event_queue<moved, renamed, closed>();
+        auto received = vector<string>();
+        eq.add_handler<moved>([&](const point& p) { received.push_back(to_string(p.x + p.y)); });
+        eq.add_handler<renamed>([&](string s) { received.push_back(s); });
+        eq.add_handler<closed>([&]() { received.push_back("closed"); });
+
+        eq.fire<moved>(point { 3, 6 });
+        eq.fire<renamed>("window");
+        eq.fire<closed>();
+        REQUIRE(received == (vector<string> { "9", "window", "closed" }));
+    }
+
+    SECTION("removes handlers with handler_info") {
+        auto eq = static_event_queue<moved, closed>();
+        auto calls = 0;
+        auto handler0 = eq.add_handler<closed>([&]() { calls += 1; });
+        auto handler1 = eq.add_handler<closed>([&]() { calls += 10; });
+        auto copy = handler0;
+
+        eq.remove_handler(handler0);
+        REQUIRE(copy.removed());
+        REQUIRE_FALSE(handler1.removed());
+        eq.fire<closed>();
+        REQUIRE(calls == 10);
+
+        typedef handler_info<closed, void>::handler_removed handler_removed;
+        REQUIRE_THROWS_AS(eq.remove_handler(copy), handler_removed);
+    }
+
+    SECTION("handlers can add and remove handlers while firing") {
+        auto eq = static_event_queue<moved>();
+        auto calls = 0;
+        handler_info<moved, point>* ptr_self;
+        auto self = eq.add_handler<moved>([&](const point&) {
+            ++calls;
+            eq.remove_handler(*ptr_self);
+            eq.add_handler<moved>([&](const point&) { calls += 10; });
+        });
+        ptr_self = &self;
+
+        eq.fire<moved>(point { 0, 0 });
+        REQUIRE(calls == 1);
+        eq.fire<moved>(point { 0, 0 });
+        REQUIRE(calls == 11);
+    }
+
+    SECTION("fires through a channel") {
+        auto eq = static_event_queue<moved, renamed>();
+        auto total = 0;
+        eq.add_handler<moved>([&](point p) { total += p.x; });
+
+        auto ch = eq.channel<moved>();
+        ch.fire(point { 2, 0 });
+        ch.fire(point { 3, 0 });
+        REQUIRE(total == 5);
+    }
+
+    SECTION("moving keeps the handlers and their handler_info") {
+        auto eq = static_event_queue<moved, closed>();
+        auto calls = 0;
+        auto handler0 = eq.add_handler<closed>([&]() { calls += 1; });
+        eq.add_handler<closed>([&]() { calls += 10; });
+
+        auto moved_to = move(eq);
+        moved_to.fire<closed>();
+        REQUIRE(calls == 11);
+
+        moved_to.remove_handler(handler0);
+        REQUIRE(handler0.removed());
+        moved_to.channel<closed>().fire();
+        REQUIRE(calls == 21);
+    }
+}
@@ -0,0 +1,63 @@
+#include <stdexcept>
+#include <string>
+#include "catch.hpp"
+#include "../eventus.hpp"
+
+using namespace eventus;
+using namespace std;
+
+TEST_CASE("string_pool", "[symbol]") {
+    SECTION("interns each string once") {
+        string_pool pool;
+        auto moved = pool.intern("moved");
+        auto resized = pool.intern(string("resized"));
+        REQUIRE(moved);
+        REQUIRE(moved != resized);
+        REQUIRE(pool.intern("moved") == moved);
+        REQUIRE(pool.find("resized") == resized);
+        REQUIRE(pool.size() == 2);
+
+        REQUIRE(pool.name(moved) == "moved");
+        REQUIRE(pool.name(resized) == "resized");
+    }
+
+    SECTION("find doesn't intern") {
+        string_pool pool;
+        REQUIRE_FALSE(pool.find("moved"));
+        REQUIRE(pool.size() == 0);
+        REQUIRE_THROWS_AS(pool.name(symbol()), out_of_range);
+    }
+
+    SECTION("looks up strings which aren't null terminated") {
+        string_pool pool;
+        auto moved = pool.intern("moved");
+        const char* text = "moved.resized";
+        REQUIRE(pool.find(text, 5) == moved);
+        REQUIRE_FALSE(pool.find(text, 4));
+    }
+
+    SECTION("keeps every string as it grows") {
+        string_pool pool;
+        for (auto i = 0; i < 1000; ++i)
+            REQUIRE(pool.intern("event" + to_string(i)).id() == static_cast<uint32_t>(i + 1));
+        for (auto i = 0; i < 1000; ++i) {
+            auto sym = pool.find("event" + to_string(i));
+            REQUIRE(sym.id() == static_cast<uint32_t>(i + 1));
+            REQUIRE(pool.name(sym) == "event" + to_string(i));
+        }
+        REQUIRE(pool.size() == 1000);
+    }
+
+    SECTION("symbols can be used as event types") {
+        string_pool pool;
+        auto eq = event_queue<symbol>();
+        auto calls = 0;
+        eq.add_handler<int>(pool.intern("moved"), [&](int i) { calls += i; });
+        eq.add_handler(pool.intern("closed"), [&]() { calls += 100; });
+
+        eq.fire(pool.find("moved"), 3);
+        eq.fire(pool.find("closed"));
+        eq.fire(pool.find("unknown"), 3);
+        REQUIRE(calls == 103);
+    }
+}
@@ -0,0 +1,121 @@
+#define CATCH_CONFIG_MAIN
+#define EVENTUS_TRACE
+#define EVENTUS_TRACE_BUFFER_SIZE 64
+
+#include <cstdio>
+#include <string>
+#include <thread>
+#include "catch.hpp"
+#include "../eventus.hpp"
+
+using namespace eventus;
+using namespace std;
+
+// EVENTUS_TRACE changes the layout of the handler tables, so these tests are built as their own executable.
+
+namespace {
+    enum class window_event : unsigned { MOVED, RESIZED };
+
+    struct moved { using payload = int; };
+
+    // Writes the trace to a file and reads it back.
+    string read_trace() {
+        const char* path = "eventus_trace_test.json";
+        REQUIRE(write_trace(path));
+        auto file = fopen(path, "r");
+        REQUIRE(file != nullptr);
+        auto result = string();
+        char buffer[4096];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+            result.append(buffer, n);
+        fclose(file);
+        remove(path);
+        return result;
+    }
+
+    size_t count(const string& s, const string& part) {
+        size_t result = 0;
+        for (auto i = s.find(part); i != string::npos; i = s.find(part, i + 1))
+            ++result;
+        return result;
+    }
+}
+
+TEST_CASE("tracing", "[trace]") {
+    clear_trace();
+
+    SECTION("records a span for each fire and each handler call") {
+        auto eq = event_queue<string>();
+        eq.add_handler<int>("moved", [](int) {});
+        eq.add_handler<int>("moved", [](int) {});
+        eq.add_handler("closed", []() {});
+        eq.fire("moved", 1);
+        eq.fire("closed");
+        eq.fire("unknown", 1);
+
+        auto trace = read_trace();
+        REQUIRE(trace.find("{\"traceEvents\":[") == 0);
+        REQUIRE(count(trace, "\"ph\":\"X\"") == 5);
+        REQUIRE(count(trace, "{\"name\":\"moved\",\"cat\":\"fire\"") == 1);
+        REQUIRE(count(trace, "{\"name\":\"moved\",\"cat\":\"handler\"") == 2);
+        REQUIRE(count(trace, "{\"name\":\"closed\",\"cat\":\"fire\"") == 1);
+        REQUIRE(count(trace, "\"args\":{\"type\":\"int\",\"depth\":0}") == 3);
+        REQUIRE(count(trace, "\"args\":{\"type\":\"void\",\"depth\":0}") == 2);
+        REQUIRE(trace.find("unknown") == string::npos);
+        REQUIRE(trace.find("\"dropped_spans\":0") != string::npos);
+    }
+
+    SECTION("records the depth of reentrant fires") {
+        auto eq = event_queue<window_event>();
+        eq.add_handler<int>(window_event::MOVED, [&eq](int i) {
+            if (i > 0)
+                eq.fire(window_event::MOVED, i - 1);
+        });
+        eq.fire(window_event::MOVED, 2);
+
+        auto trace = read_trace();
+        REQUIRE(count(trace, "{\"name\":\"0\",\"cat\":\"fire\"") == 3);
+        for (auto depth = 0; depth < 3; ++depth) {
+            auto args = "\"depth\":" + to_string(depth) + "}";
+            REQUIRE(count(trace, args) == 2);
+        }
+    }
+
+    SECTION("names static events by type, and escapes names") {
+        auto eq = static_event_queue<::moved>();
+        eq.add_handler<::moved>([](int) {});
+        eq.fire<::moved>(1);
+        auto strings = event_queue<string>();
+        strings.add_handler("say \"hi\"\\", []() {});
+        strings.fire("say \"hi\"\\");
+
+        auto trace = read_trace();
+        // GCC and Clang spell the anonymous namespace differently
+        auto gcc_name = count(trace, "{\"name\":\"{anonymous}::moved\"");
+        auto clang_name = count(trace, "{\"name\":\"(anonymous namespace)::moved\"");
+        REQUIRE(gcc_name + clang_name == 2);
+        REQUIRE(count(trace, "{\"name\":\"say \\\"hi\\\"\\\\\"") == 2);
+    }
+
+    SECTION("records spans of each thread in its own buffer, and counts the ones dropped when it is full") {
+        auto fire = [](int fires) {
+            auto eq = event_queue<int>();
+            eq.add_handler(0, []() {});
+            for (auto i = 0; i < fires; ++i)
+                eq.fire(0);
+        };
+        thread(fire, 10).join();
+        thread(fire, 40).join();
+
+        // Each fire records two spans, and a buffer holds 64
+        auto trace = read_trace();
+        REQUIRE(count(trace, "\"ph\":\"X\"") == 20 + 64);
+        REQUIRE(trace.find("\"dropped_spans\":16") != string::npos);
+        REQUIRE(count(trace, "\"tid\":") == 20 + 64);
+    }
+
+    SECTION("returns false when the file can't be written") {
+        REQUIRE_FALSE(write_trace("no/such/directory/trace.json"));
+    }
+}